@@ -4,15 +4,42 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <linux/mman.h>
+#include <linux/mempolicy.h>
 #include <string.h>
 
 #include "alloc.h"
 
-void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment) {
+/* bind_mem_node() sets an MPOL_BIND policy on [p, p+length) so that pages
+   are allocated from mem_node when they are first touched.  The raw system
+   call is used so that libnuma is not needed to build loaded-latency. */
+
+static void bind_mem_node(void * p, size_t length, int mem_node) {
+    unsigned long nodemask[MAX_MEM_NODES / (8 * sizeof(unsigned long))];
+
+    if (mem_node < 0 || mem_node >= MAX_MEM_NODES) {
+        printf("ERROR: memory node %d is out of range [0, %d)\n", mem_node, MAX_MEM_NODES);
+        exit(-1);
+    }
+
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[mem_node / (8 * sizeof(unsigned long))] |= 1UL << (mem_node % (8 * sizeof(unsigned long)));
+
+    // maxnode is one more than the number of bits in nodemask because the kernel uses maxnode - 1 bits
+    if (syscall(SYS_mbind, p, length, MPOL_BIND, nodemask, MAX_MEM_NODES + 1, MPOL_MF_STRICT | MPOL_MF_MOVE)) {
+        printf("ERROR: mbind() to memory node %d failed: %s\n", mem_node, strerror(errno));
+        exit(-1);
+    }
+}
+
+void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment, int mem_node) {
 
     if (use_hugepages != HUGEPAGES_NONE) {
         int hugepage_size_flag = HUGEPAGES_DEFAULT;
@@ -36,9 +63,13 @@ void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment) {
                 hugepage_size_flag = MAP_HUGE_16GB;
                 break;
         }
+
+        // when binding to a node, populate after mbind() instead of in mmap()
+        int populate_flag = (mem_node == MEM_NODE_NONE) ? MAP_POPULATE : 0;
+
         void * mmap_ret = mmap(NULL, length,
                        PROT_READ|PROT_WRITE,
-                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|MAP_POPULATE|hugepage_size_flag,
+                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|populate_flag|hugepage_size_flag,
                        -1, 0);
 
         if (mmap_ret == MAP_FAILED) {
@@ -53,16 +84,42 @@ void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment) {
             exit(-1);
         }
 
+        if (mem_node != MEM_NODE_NONE) {
+            bind_mem_node(mmap_ret, length, mem_node);
+            memset(mmap_ret, 1, length);
+        }
+
         return mmap_ret;
     }
 
     void * p;
 
-    int ret = posix_memalign((void **) &p, nonhuge_alignment, length);
+    if (mem_node != MEM_NODE_NONE) {
 
-    if (ret) {
-        printf("posix_memalign returned %d, exiting\n", ret);
-        exit(-1);
+        // use a fresh mapping so that no page has been touched before mbind()
+
+        if (nonhuge_alignment > (size_t) sysconf(_SC_PAGESIZE)) {
+            printf("ERROR: alignment %zu is larger than the page size for a node-bound allocation\n", nonhuge_alignment);
+            exit(-1);
+        }
+
+        p = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+        if (p == MAP_FAILED) {
+            printf("mmap returned %p (MAP_FAILED) for %zu bytes on memory node %d, exiting\n", p, length, mem_node);
+            exit(-1);
+        }
+
+        bind_mem_node(p, length, mem_node);
+
+    } else {
+
+        int ret = posix_memalign((void **) &p, nonhuge_alignment, length);
+
+        if (ret) {
+            printf("posix_memalign returned %d, exiting\n", ret);
+            exit(-1);
+        }
     }
 
     // prefault
@@ -70,3 +127,62 @@ void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment) {
 
     return p;
 }
+
+/* report_mem_nodes() prints the number of pages of [p, p+length) that
+   reside on each NUMA node, as reported by move_pages() with nodes = NULL. */
+
+#define MEM_NODE_QUERY_BATCH 4096
+
+void report_mem_nodes(const char * label, void * p, size_t length) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t num_pages = (length + page_size - 1) / page_size;
+    char * first_page = (char *) ((unsigned long) p & ~(page_size - 1));
+
+    void * pages[MEM_NODE_QUERY_BATCH];
+    int    status[MEM_NODE_QUERY_BATCH];
+
+    size_t * node_pages = calloc(MAX_MEM_NODES, sizeof(size_t));
+    size_t error_pages = 0;
+    int    last_errno = 0;
+
+    if (node_pages == NULL) {
+        printf("calloc failed in report_mem_nodes, exiting\n");
+        exit(-1);
+    }
+
+    for (size_t i = 0; i < num_pages; i += MEM_NODE_QUERY_BATCH) {
+        size_t count = num_pages - i < MEM_NODE_QUERY_BATCH ? num_pages - i : MEM_NODE_QUERY_BATCH;
+
+        for (size_t j = 0; j < count; j++) {
+            pages[j] = first_page + (i + j) * page_size;
+        }
+
+        if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0)) {
+            printf("%s: move_pages() failed: %s, memory node placement is unknown\n", label, strerror(errno));
+            free(node_pages);
+            return;
+        }
+
+        for (size_t j = 0; j < count; j++) {
+            if (status[j] >= 0 && status[j] < MAX_MEM_NODES) {
+                node_pages[status[j]]++;
+            } else {
+                error_pages++;
+                last_errno = -status[j];
+            }
+        }
+    }
+
+    printf("%s: %zu pages:", label, num_pages);
+    for (int node = 0; node < MAX_MEM_NODES; node++) {
+        if (node_pages[node]) {
+            printf(" node%d = %zu (%.1f%%)", node, node_pages[node], 100. * node_pages[node] / num_pages);
+        }
+    }
+    if (error_pages) {
+        printf(" unknown = %zu (%s)", error_pages, strerror(last_errno));
+    }
+    printf("\n");
+
+    free(node_pages);
+}
@@ -19,7 +19,11 @@ enum {
     HUGEPAGES_MAX_ENUM
 };
 
+#define MEM_NODE_NONE   -1      // do not bind memory; use the default NUMA memory policy
+#define MAX_MEM_NODES   1024    // highest NUMA node number + 1 that can be bound to
 
-void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment);
+void * do_alloc(size_t length, int use_hugepages, size_t nonhuge_alignment, int mem_node);
+
+void report_mem_nodes(const char * label, void * p, size_t length);
 
 #endif
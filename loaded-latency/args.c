@@ -5,15 +5,22 @@
  */
 
 #define _GNU_SOURCE
+#include <pthread.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <sched.h>
 #include <stdio.h>
+#include <string.h>
 #include <strings.h>
+#include <ctype.h>
 
 #include "args.h"
 #include "alloc.h"
+#include "bwkernels.h"
+#include "output.h"
+#include "topology.h"
+#include "c2c.h"
 
 static const struct {
     const char * size_string;
@@ -83,25 +90,650 @@ PRINT_HUGEPAGES:
     return use_hugepages;
 }
 
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} bw_kernel_mapping[] = {
+    { "auto", BW_KERNEL_AUTO },
+    { "scalar", BW_KERNEL_SCALAR },
+    { "neon", BW_KERNEL_NEON },
+    { "sve", BW_KERNEL_SVE },
+    { "avx2", BW_KERNEL_AVX2 },
+    { "avx512", BW_KERNEL_AVX512 },
+};
+
+const size_t num_bw_kernel_mappings = sizeof(bw_kernel_mapping) / sizeof(bw_kernel_mapping[0]);
+
+const char * bw_kernel_map (int enum_param_value) {
+    for (size_t i = 0; i < num_bw_kernel_mappings; i++) {
+        if (bw_kernel_mapping[i].enum_param_value == enum_param_value) {
+            return bw_kernel_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_bw_kernel_parameter(const char * optarg) {
+    size_t i;
+
+    for (i = 0; i < num_bw_kernel_mappings; i++) {
+        if (0 == strcasecmp(optarg, bw_kernel_mapping[i].name)) {
+            return bw_kernel_mapping[i].enum_param_value;
+        }
+    }
+
+    if (strcasecmp(optarg, "help")) {
+        printf("Error: unknown --bw-kernel %s\n", optarg);
+    }
+
+    printf("bandwidth kernels:\n");
+    for (i = 0; i < num_bw_kernel_mappings; i++) {
+        printf("%s\n", bw_kernel_mapping[i].name);
+    }
+
+    exit(-1);
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} bw_write_mode_mapping[] = {
+    { "store", BW_WRITE_STORE },
+    { "dczva", BW_WRITE_DCZVA },
+    { "nt", BW_WRITE_NT },
+    { "rmw", BW_WRITE_RMW },
+};
+
+const size_t num_bw_write_mode_mappings = sizeof(bw_write_mode_mapping) / sizeof(bw_write_mode_mapping[0]);
+
+const char * bw_write_mode_map (int enum_param_value) {
+    for (size_t i = 0; i < num_bw_write_mode_mappings; i++) {
+        if (bw_write_mode_mapping[i].enum_param_value == enum_param_value) {
+            return bw_write_mode_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_bw_write_mode_parameter(const char * optarg) {
+    size_t i;
+
+    for (i = 0; i < num_bw_write_mode_mappings; i++) {
+        if (0 == strcasecmp(optarg, bw_write_mode_mapping[i].name)) {
+            return bw_write_mode_mapping[i].enum_param_value;
+        }
+    }
+
+    if (strcasecmp(optarg, "help")) {
+        printf("Error: unknown --bw-write-mode %s\n", optarg);
+    }
+
+    printf("bandwidth write modes:\n");
+    for (i = 0; i < num_bw_write_mode_mappings; i++) {
+        printf("%s\n", bw_write_mode_mapping[i].name);
+    }
+
+    exit(-1);
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} bw_kind_mapping[] = {
+    { "read", BW_KIND_READ },
+    { "write", BW_KIND_WRITE },
+    { "atomic", BW_KIND_ATOMIC },
+    { "copy", BW_KIND_COPY },
+    { "scale", BW_KIND_SCALE },
+    { "add", BW_KIND_ADD },
+    { "triad", BW_KIND_TRIAD },
+};
+
+const size_t num_bw_kind_mappings = sizeof(bw_kind_mapping) / sizeof(bw_kind_mapping[0]);
+
+const char * bw_kind_map (int enum_param_value) {
+    for (size_t i = 0; i < num_bw_kind_mappings; i++) {
+        if (bw_kind_mapping[i].enum_param_value == enum_param_value) {
+            return bw_kind_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_bw_kind_parameter(const char * optarg) {
+    for (size_t i = 0; i < num_bw_kind_mappings; i++) {
+        if (0 == strcasecmp(optarg, bw_kind_mapping[i].name)) {
+            return bw_kind_mapping[i].enum_param_value;
+        }
+    }
+
+    printf("Error: unknown --bw-kind %s, use read, write, atomic, copy, scale, add or triad\n", optarg);
+    exit(-1);
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} bw_atomic_op_mapping[] = {
+    { "add", BW_ATOMIC_ADD },
+    { "cas", BW_ATOMIC_CAS },
+};
+
+const size_t num_bw_atomic_op_mappings = sizeof(bw_atomic_op_mapping) / sizeof(bw_atomic_op_mapping[0]);
+
+const char * bw_atomic_op_map (int enum_param_value) {
+    for (size_t i = 0; i < num_bw_atomic_op_mappings; i++) {
+        if (bw_atomic_op_mapping[i].enum_param_value == enum_param_value) {
+            return bw_atomic_op_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_bw_atomic_op_parameter(const char * optarg) {
+    for (size_t i = 0; i < num_bw_atomic_op_mappings; i++) {
+        if (0 == strcasecmp(optarg, bw_atomic_op_mapping[i].name)) {
+            return bw_atomic_op_mapping[i].enum_param_value;
+        }
+    }
+
+    printf("Error: unknown --bw-atomic-op %s, use add or cas\n", optarg);
+    exit(-1);
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} bw_pattern_mapping[] = {
+    { "sequential", BW_PATTERN_SEQUENTIAL },
+    { "random", BW_PATTERN_RANDOM },
+    { "strided", BW_PATTERN_STRIDED },
+};
+
+const size_t num_bw_pattern_mappings = sizeof(bw_pattern_mapping) / sizeof(bw_pattern_mapping[0]);
+
+const char * bw_pattern_map (int enum_param_value) {
+    for (size_t i = 0; i < num_bw_pattern_mappings; i++) {
+        if (bw_pattern_mapping[i].enum_param_value == enum_param_value) {
+            return bw_pattern_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} output_format_mapping[] = {
+    { "none", OUTPUT_NONE },
+    { "json", OUTPUT_JSON },
+    { "csv", OUTPUT_CSV },
+};
+
+const size_t num_output_format_mappings = sizeof(output_format_mapping) / sizeof(output_format_mapping[0]);
+
+const char * output_format_map (int enum_param_value) {
+    for (size_t i = 0; i < num_output_format_mappings; i++) {
+        if (output_format_mapping[i].enum_param_value == enum_param_value) {
+            return output_format_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_output_format_parameter(const char * optarg) {
+    for (size_t i = 0; i < num_output_format_mappings; i++) {
+        if (0 == strcasecmp(optarg, output_format_mapping[i].name)) {
+            return output_format_mapping[i].enum_param_value;
+        }
+    }
+
+    printf("Error: unknown --output format %s, use json or csv\n", optarg);
+    exit(-1);
+}
+
+static const struct {
+    const char * name;
+    const int enum_param_value;
+} c2c_mode_mapping[] = {
+    { "store", C2C_MODE_STORE },
+    { "atomic", C2C_MODE_ATOMIC },
+};
+
+const size_t num_c2c_mode_mappings = sizeof(c2c_mode_mapping) / sizeof(c2c_mode_mapping[0]);
+
+const char * c2c_mode_map (int enum_param_value) {
+    for (size_t i = 0; i < num_c2c_mode_mappings; i++) {
+        if (c2c_mode_mapping[i].enum_param_value == enum_param_value) {
+            return c2c_mode_mapping[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_c2c_mode_parameter(const char * optarg) {
+    for (size_t i = 0; i < num_c2c_mode_mappings; i++) {
+        if (0 == strcasecmp(optarg, c2c_mode_mapping[i].name)) {
+            return c2c_mode_mapping[i].enum_param_value;
+        }
+    }
+
+    printf("Error: unknown --c2c-mode %s, use store or atomic\n", optarg);
+    exit(-1);
+}
+
+// parse one term of a CPU list: a CPU, a CPU range, or a topology selector
+
+static const char * parse_cpu_term(const char * name, const char * optarg, const char * s,
+        const cpu_set_t * lat_cpuset, cpu_set_t * term) {
+    char * endptr;
+
+    CPU_ZERO(term);
+
+    if (strncmp(s, "all", 3) == 0) {
+        topology_allowed_cpus(term);
+        return s + 3;
+    }
+
+    if (strncmp(s, "cores", 5) == 0) {
+        topology_core_cpus(term);
+        return s + 5;
+    }
+
+    if (strncmp(s, "lat", 3) == 0 && lat_cpuset) {
+        CPU_OR(term, term, lat_cpuset);
+        return s + 3;
+    }
+
+    if (strncmp(s, "node:", 5) == 0) {
+        long node = strtol(s + 5, &endptr, 0);
+        if (endptr == s + 5 || ! topology_node_cpus(node, term)) {
+            printf("Error: no NUMA node %.*s in %s CPU list \"%s\"\n", (int) (endptr - (s + 5)), s + 5, name, optarg);
+            exit(-1);
+        }
+        return endptr;
+    }
+
+    long first = strtol(s, &endptr, 0);
+    long last = first;
+
+    if (endptr != s && *endptr == '-') {
+        s = endptr + 1;
+        last = strtol(s, &endptr, 0);
+    }
+
+    if (endptr == s || first < 0 || last < first || last >= CPU_SETSIZE) {
+        printf("Error: bad %s CPU list \"%s\"\n", name, optarg);
+        exit(-1);
+    }
+
+    for (long cpu = first; cpu <= last; cpu++) {
+        CPU_SET(cpu, term);
+    }
+
+    return endptr;
+}
+
+/* parse a comma-separated list of CPUs and CPU ranges, e.g. "4" or
+   "0-3,8,10-11".  An item can also be a topology selector (all, cores,
+   node:N, or lat if lat_cpuset is not NULL), the intersection of terms
+   joined by '&', or preceded by '^' to remove its CPUs from the items
+   before it, e.g. "node:1&cores,^lat". */
+
+static void parse_cpu_list(const char * name, const char * optarg, const cpu_set_t * lat_cpuset, cpu_set_t * cpuset) {
+    const char * s = optarg;
+
+    CPU_ZERO(cpuset);
+
+    while (*s) {
+        cpu_set_t item, term;
+        int exclude = (*s == '^');
+
+        s = parse_cpu_term(name, optarg, s + exclude, lat_cpuset, &item);
+
+        while (*s == '&') {
+            s = parse_cpu_term(name, optarg, s + 1, lat_cpuset, &term);
+            CPU_AND(&item, &item, &term);
+        }
+
+        if (*s != ',' && *s != '\0') {
+            printf("Error: bad %s CPU list \"%s\"\n", name, optarg);
+            exit(-1);
+        }
+
+        if (exclude) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &item)) {
+                    CPU_CLR(cpu, cpuset);
+                }
+            }
+        } else {
+            CPU_OR(cpuset, cpuset, &item);
+        }
+
+        s = (*s == ',') ? s + 1 : s;
+    }
+
+    if (CPU_COUNT(cpuset) == 0) {
+        printf("Error: empty %s CPU list \"%s\"\n", name, optarg);
+        exit(-1);
+    }
+}
+
+// print a CPU set as a CPU list with ranges, e.g. "0-15,32-47"
+
+static void print_cpu_list(const cpu_set_t * cpuset) {
+    const char * sep = "";
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (! CPU_ISSET(cpu, cpuset)) {
+            continue;
+        }
+
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpuset)) {
+            last++;
+        }
+
+        if (last == cpu) {
+            printf("%s%d", sep, cpu);
+        } else {
+            printf("%s%d-%d", sep, cpu, last);
+        }
+        sep = ",";
+        cpu = last;
+    }
+}
+
+// parse a comma-separated list of NUMA node numbers, e.g. "0" or "0,1,1,0"
+
+static int parse_mem_node_list(const char * name, const char * optarg, int * nodes) {
+    int count = 0;
+    const char * s = optarg;
+
+    while (*s) {
+        char * endptr;
+        long node = strtol(s, &endptr, 0);
+
+        if (endptr == s || (*endptr != ',' && *endptr != '\0') || node < 0 || node >= MAX_MEM_NODES) {
+            printf("Error: bad --%s node list \"%s\"\n", name, optarg);
+            exit(-1);
+        }
+
+        if (count == CPU_SETSIZE) {
+            printf("Error: too many nodes in --%s node list \"%s\"\n", name, optarg);
+            exit(-1);
+        }
+
+        nodes[count++] = node;
+        s = (*endptr == ',') ? endptr + 1 : endptr;
+    }
+
+    return count;
+}
+
+// parse a comma-separated list of counts, e.g. "100,50,30,20,15,10,5,0"
+
+static size_t parse_count_list(const char * name, const char * optarg, size_t * counts, size_t max_counts) {
+    size_t count = 0;
+    const char * s = optarg;
+
+    while (*s) {
+        char * endptr;
+        size_t value = strtoul(s, &endptr, 0);
+
+        if (endptr == s || (*endptr != ',' && *endptr != '\0')) {
+            printf("Error: bad --%s list \"%s\"\n", name, optarg);
+            exit(-1);
+        }
+
+        if (count == max_counts) {
+            printf("Error: more than %zu entries in --%s list \"%s\"\n", max_counts, name, optarg);
+            exit(-1);
+        }
+
+        counts[count++] = value;
+        s = (*endptr == ',') ? endptr + 1 : endptr;
+    }
+
+    return count;
+}
+
+// parse a size in bytes with an optional K, M, G or T suffix for powers of 1024, e.g. "16K"
+
+static size_t parse_size(const char * name, const char * optarg, const char * s, char ** endptr) {
+    size_t value = strtoul(s, endptr, 0);
+
+    if (*endptr == s) {
+        printf("Error: bad --%s size in \"%s\"\n", name, optarg);
+        exit(-1);
+    }
+
+    switch (toupper(**endptr)) {
+        case 'T': value <<= 10;     // fall through
+        case 'G': value <<= 10;     // fall through
+        case 'M': value <<= 10;     // fall through
+        case 'K': value <<= 10;
+                  (*endptr)++;
+                  break;
+        default:  break;
+    }
+
+    return value;
+}
+
+// parse a comma-separated list of sizes and ranges of sizes that grow by a factor, e.g. "16K..4G:x2,6G"
+
+static size_t parse_size_list(const char * name, const char * optarg, size_t * sizes, size_t max_sizes) {
+    size_t count = 0;
+    const char * s = optarg;
+
+    while (*s) {
+        char * endptr;
+        size_t first = parse_size(name, optarg, s, &endptr);
+        size_t last = first;
+        size_t factor = 2;
+
+        if (strncmp(endptr, "..", 2) == 0) {
+            last = parse_size(name, optarg, endptr + 2, &endptr);
+            if (strncmp(endptr, ":x", 2) == 0) {
+                s = endptr + 2;
+                factor = strtoul(s, &endptr, 0);
+                if (endptr == s) {
+                    factor = 0;
+                }
+            }
+        }
+
+        if ((*endptr != ',' && *endptr != '\0') || first == 0 || last < first || factor < 2) {
+            printf("Error: bad --%s list \"%s\"\n", name, optarg);
+            exit(-1);
+        }
+
+        for (size_t size = first; ; size *= factor) {
+            if (count == max_sizes) {
+                printf("Error: more than %zu sizes in --%s list \"%s\"\n", max_sizes, name, optarg);
+                exit(-1);
+            }
+            sizes[count++] = size;
+
+            if (size > last / factor) {
+                break;
+            }
+        }
+
+        s = (*endptr == ',') ? endptr + 1 : endptr;
+    }
+
+    return count;
+}
+
+/* parse the overrides after the CPU of -B cpu:override... such as
+   "write:L=64M:F=20": a --bw-kind name, or KEY=value where KEY is the short
+   flag of the setting, L (bytes), F, C or I. */
+
+static void parse_bw_override(const char * optarg, const char * s, struct bw_override * ov) {
+    if (! ov->set) {
+        *ov = (struct bw_override) { .set = 1, .bw_kind = -1, .bw_inner_nops = -1, .bw_outer_nops = -1 };
+    }
+
+    while (*s) {
+        char * endptr = (char *) s;
+
+        if (s[0] && s[1] == '=') {
+            const char * value = s + 2;
+
+            switch (s[0]) {
+                case 'L': ov->bw_buflen = parse_size("bw-cpu", optarg, value, &endptr); break;
+                case 'F': ov->bw_inner_nops = strtol(value, &endptr, 0); break;
+                case 'C': ov->bw_outer_nops = strtol(value, &endptr, 0); break;
+                case 'I': ov->bw_iterations = strtoul(value, &endptr, 0); break;
+                default:  break;
+            }
+
+            if (endptr == value || (*endptr != ':' && *endptr != '\0') ||
+                (s[0] == 'F' && ov->bw_inner_nops < 0) || (s[0] == 'C' && ov->bw_outer_nops < 0) ||
+                (s[0] == 'L' && ov->bw_buflen == 0) || (s[0] == 'I' && ov->bw_iterations == 0)) {
+                printf("Error: bad -B override in \"%s\", use kind, L=bytes, F=count, C=count or I=iters\n", optarg);
+                exit(-1);
+            }
+        } else {
+            size_t len = strcspn(s, ":");
+            int found = 0;
+
+            for (size_t i = 0; i < num_bw_kind_mappings; i++) {
+                if (strlen(bw_kind_mapping[i].name) == len && 0 == strncasecmp(s, bw_kind_mapping[i].name, len)) {
+                    ov->bw_kind = bw_kind_mapping[i].enum_param_value;
+                    found = 1;
+                }
+            }
+
+            // the atomic lines are shared by all bandwidth threads, so atomic is only a global --bw-kind
+            if (! found || ov->bw_kind == BW_KIND_ATOMIC) {
+                printf("Error: bad -B kind in \"%s\", use read, write, copy, scale, add or triad\n", optarg);
+                exit(-1);
+            }
+            endptr = (char *) s + len;
+        }
+
+        s = (*endptr == ':') ? endptr + 1 : endptr;
+    }
+}
+
+// parse the overrides after the CPU of -l cpu:override... such as "n=16384:j=2"
+
+static void parse_lat_override(const char * optarg, const char * s, struct lat_override * ov) {
+    ov->set = 1;
+
+    while (*s) {
+        char * endptr = (char *) s;
+        const char * value = s + 2;
+        size_t * field = NULL;
+
+        if (s[0] && s[1] == '=') {
+            switch (s[0]) {
+                case 'n': field = &ov->lat_cacheline_count; break;
+                case 'j': field = &ov->lat_cacheline_stride; break;
+                default:  break;
+            }
+        }
+
+        if (field) {
+            *field = strtoul(value, &endptr, 0);
+        }
+
+        if (field == NULL || endptr == value || (*endptr != ':' && *endptr != '\0') || *field == 0) {
+            printf("Error: bad -l override in \"%s\", use n=count or j=count\n", optarg);
+            exit(-1);
+        }
+
+        s = (*endptr == ':') ? endptr + 1 : endptr;
+    }
+}
+
+// returns the CPU of -l or -B, and parses the overrides that follow it, if any
+
+static long parse_thread_cpu(const char * optarg, args_t * pargs, int bw) {
+    char * endptr;
+    long cpu = strtol(optarg, &endptr, 0);
+
+    if (*endptr == ':') {
+        if (endptr == optarg || cpu < 0 || cpu >= CPU_SETSIZE) {
+            printf("Error: bad CPU in \"%s\"\n", optarg);
+            exit(-1);
+        }
+        if (bw) {
+            parse_bw_override(optarg, endptr + 1, &pargs->bw_overrides[cpu]);
+        } else {
+            parse_lat_override(optarg, endptr + 1, &pargs->lat_overrides[cpu]);
+        }
+    }
+
+    return cpu;
+}
+
+// parse --bw-pattern sequential|random|strided:N, where N is a size in bytes
+
+static void parse_bw_pattern(const char * optarg, args_t * pargs) {
+    const char * stride = strchr(optarg, ':');
+    size_t name_len = stride ? (size_t) (stride - optarg) : strlen(optarg);
+    int found = 0;
+
+    for (size_t i = 0; i < num_bw_pattern_mappings; i++) {
+        if (strlen(bw_pattern_mapping[i].name) == name_len &&
+            0 == strncasecmp(optarg, bw_pattern_mapping[i].name, name_len)) {
+            pargs->bw_pattern = bw_pattern_mapping[i].enum_param_value;
+            found = 1;
+        }
+    }
+
+    if (! found) {
+        printf("Error: unknown --bw-pattern %s, use sequential, random or strided:bytes\n", optarg);
+        exit(-1);
+    }
+
+    if (pargs->bw_pattern == BW_PATTERN_STRIDED && stride == NULL) {
+        printf("Error: --bw-pattern strided needs a stride, as strided:bytes\n");
+        exit(-1);
+    }
+    if (pargs->bw_pattern != BW_PATTERN_STRIDED && stride != NULL) {
+        printf("Error: --bw-pattern %s: only strided takes a stride\n", optarg);
+        exit(-1);
+    }
+
+    if (stride) {
+        char * endptr;
+        pargs->bw_stride_bytes = parse_size("bw-pattern", optarg, stride + 1, &endptr);
+        if (*endptr != '\0' || pargs->bw_stride_bytes == 0) {
+            printf("Error: bad --bw-pattern stride in \"%s\"\n", optarg);
+            exit(-1);
+        }
+    }
+}
+
 static void print_help(void) {
     printf(
 "./loaded-latency [args]\n"
 "\n"
 " -D | --duration              seconds     how many seconds to run\n"
 " -S | --random-seed           seedval     set random seed to seedval\n"
-" -d | --delay-seconds         seconds     how many seconds to wait for threads to start together\n"
-"      --delay-ticks           ticks       how many HWCOUNTER ticks to wait for threads to start together\n"
+" -d | --delay-seconds         seconds     margin from the last thread being ready to the start (default 0.01)\n"
+"      --delay-ticks           ticks       margin in HWCOUNTER ticks from the last thread being ready to the start\n"
 "      --show-per-thread-concurrency       show per-thread concurrency metrics\n"
+"      --perf                              count PMU events (or software events) of each thread per interval\n"
 " -Q | --mitigate-spectre-v4               enable mitigation for Spectre v4 (SSBD=1 or SSBS=0) using prctl()\n"
 " -q | --hwclock-freq          freq_hz     frequency in Hz of the hwclock counter\n"
 "      --estimate-hwclock-freq cpu_num     measure and estimate the hardware clock frequency in Hz on CPU cpu_num\n"
 " -f | --cpu-freq-mhz          frequency   CPU frequency in MHz for calculating cycles\n"
 " -t | --cpu-cycle-time-ns     nanoseconds CPU cycle time in nanoseconds for calculating cycles\n"
-"             CPU frequency and cycle time are NOT auto-detected!\n"
+"             CPU frequency and cycle time are NOT auto-detected, unless --measure-cpu-freq is used!\n"
 "             The last -f or -t overrides earlier parameters for computing cycles.\n"
+"      --measure-cpu-freq                  measure the core frequency of each latency interval for computing cycles\n"
 "\n"
 "latency flags:\n"
-" -l | --lat-cpu               cpu_num  CPU on which to run a latency thread.  Repeat for additional CPUs.\n"
+" -l | --lat-cpu               cpu_num[:override...]  CPU on which to run a latency thread.  Repeat for additional CPUs.\n"
+"                                       Overrides for this thread only: n=count or j=count, e.g. -l 2:n=16384\n"
+"      --lat-cpus              cpu_list CPUs on which to run latency threads, e.g. 0-3,8 or node:0&cores.  See README.txt\n"
 " -n | --lat-cacheline-count   count    number of sequential cachelines of memory to use for latency measurement\n"
 " -e | --lat-secondary-delay   ticks    how many additional ticks for secondary latency threads to start\n"
 " -i | --lat-iterations        iters    number of iterations between latency measurement interim reports\n"
@@ -113,10 +745,15 @@ static void print_help(void) {
 " -h | --lat-use-hugepages     size     hugepage size to use for latency. Use \"-h help\" to show known sizes\n"
 " -w | --lat-warmup-cpu        cpu_num  on which CPU to warm up latency loop (repeat for additional CPUs)\n"
 " -s | --lat-shared-memory              use the same memory for all latency threads\n"
-" -u | --lat-shared-memory-init-cpu cpu_num   on which CPU to initialize the latency shared memory\n"
+" -u | --lat-shared-memory-init-cpu cpu_list  on which CPUs to initialize the latency shared memory, e.g. 0-3\n"
+"      --lat-mem-node          node[,node...] bind latency memory to a NUMA node, listed per latency thread\n"
+"      --lat-chains            count    number of independent pointer chains (loads in flight) per latency thread\n"
 "\n"
 "bandwidth flags:\n"
-" -B | --bw-cpu                cpu_num  CPU on which to run a bandwidth thread.  Repeat for additional CPUs.\n"
+" -B | --bw-cpu                cpu_num[:override...]  CPU on which to run a bandwidth thread.  Repeat for additional CPUs.\n"
+"                                       Overrides for this thread only: a --bw-kind other than atomic, L=bytes,\n"
+"                                       F=count, C=count or I=iters, e.g. -B 4:write:L=64M:F=20\n"
+"      --bw-cpus               cpu_list CPUs on which to run bandwidth threads, e.g. 0-15,32-47 or node:1&cores,^lat\n"
 " -L | --bw-buflen             bytes    memory buffer size for bandwidth loop\n"
 " -I | --bw-iterations         iters    iterations of the bandwidth loop to run between interim reports\n"
 " -F | --bw-fine-delay         count    bandwidth fine delay (inner loop nops).  Increase to slow bandwidth.\n"
@@ -124,6 +761,35 @@ static void print_help(void) {
 " -H | --bw-use-hugepages      size     hugepage size to use for bandwidth. Use \"-H help\" to show known sizes.\n"
 " -Z | --bw-cacheline-bytes    bytes    cacheline length for bandwidth memory region size\n"
 " -W | --bw-write                       instead of reads, use writes for memory bandwidth traffic\n"
+"      --bw-write-mode         mode     use writes of this kind: store, dczva, nt or rmw.  Implies -W\n"
+"      --bw-mem-node           node[,node...] bind bandwidth memory to a NUMA node, listed per bandwidth thread\n"
+"      --bw-target-mbps        MB/sec   pace the fine delay to hold this total bandwidth of all bandwidth threads\n"
+"      --bw-target-mbps-per-thread MB/sec   pace the fine delay to hold this bandwidth in each bandwidth thread\n"
+"      --bw-kernel             name     read kernel: auto, scalar, neon, sve, avx2 or avx512.  Use \"--bw-kernel help\" to list\n"
+"      --bw-prefetch-distance  lines    software prefetch this many cache lines ahead in the bandwidth loop; 0 for none\n"
+"      --bw-pattern            pattern  order of the bandwidth accesses: sequential (default), random or strided:bytes,\n"
+"                                       e.g. strided:4K\n"
+"      --bw-kind               kind     bandwidth traffic: read (default), write (same as -W), atomic,\n"
+"                                       or the STREAM kernels copy, scale, add or triad\n"
+"      --bw-atomic-op          op       atomic operation of --bw-kind atomic: add (LDADD, LOCK XADD) or cas (default add)\n"
+"      --bw-atomic-lines       count    cache lines shared by all bandwidth threads for --bw-kind atomic (default 1)\n"
+"\n"
+"multi-phase flags:\n"
+"      --sweep-fine-delay      count[,count...]  run one --duration phase per bandwidth fine delay in one process\n"
+"      --lat-sizes             size[,size...]    run one --duration phase per latency loop size in bytes in one process,\n"
+"                                                e.g. 16K..4G:x2 for 16 KiB to 4 GiB, doubling\n"
+"      --bw-ramp               threads  run one --duration phase per step of this many more active bandwidth threads\n"
+"                                       in one process, and report where the total bandwidth saturates\n"
+"\n"
+"core-to-core latency flags:\n"
+"      --c2c-cpus              cpu_list CPUs between each pair of which to bounce a cache line for a latency matrix\n"
+"      --c2c-mode              mode     hand the cache line over with a store or an atomic compare-and-swap (default store)\n"
+"      --c2c-iterations        count    timed round trips per pair of --c2c-cpus (default 10000)\n"
+"\n"
+"output flags:\n"
+"      --output                json|csv also write the configuration, samples and results in this format\n"
+"      --output-file           filename file for --output (default format json)\n"
+"      --live-samples                   print the interim samples while the threads run instead of after they finish\n"
 "\n"
 " --help                                this screen\n"
 "\n"
@@ -143,7 +809,32 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
         help_val = 1,
         estimate_hwclock_freq_val = 2,
         delay_ticks_val = 3,
-        show_per_thread_concurrency_val = 4
+        show_per_thread_concurrency_val = 4,
+        lat_mem_node_val = 5,
+        bw_mem_node_val = 6,
+        sweep_fine_delay_val = 7,
+        bw_target_mbps_val = 8,
+        bw_target_mbps_per_thread_val = 9,
+        bw_kernel_val = 10,
+        bw_prefetch_distance_val = 11,
+        bw_write_mode_val = 12,
+        lat_chains_val = 13,
+        output_val = 14,
+        output_file_val = 15,
+        live_samples_val = 16,
+        perf_val = 17,
+        measure_cpu_freq_val = 18,
+        lat_sizes_val = 19,
+        lat_cpus_val = 20,
+        bw_cpus_val = 21,
+        bw_ramp_val = 22,
+        c2c_cpus_val = 23,
+        c2c_mode_val = 24,
+        c2c_iterations_val = 25,
+        bw_kind_val = 26,
+        bw_atomic_op_val = 27,
+        bw_atomic_lines_val = 28,
+        bw_pattern_val = 29
     };
 
     static struct option long_options[] = {
@@ -153,14 +844,17 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
         {"delay-seconds",       required_argument,  0,      'd'},
         {"delay-ticks",         required_argument,  0,      delay_ticks_val},
         {"show-per-thread-concurrency",no_argument, 0,      show_per_thread_concurrency_val},
+        {"perf",                no_argument,        0,      perf_val},
         {"mitigate-spectre-v4", no_argument,        0,      'Q'},
         {"hwclock-freq",        required_argument,  0,      'q'},
         {"estimate-hwclock-freq",required_argument, 0,      estimate_hwclock_freq_val},
         {"cpu-freq-mhz",        required_argument,  0,      'f'},
         {"cpu-cycle-time-ns",   required_argument,  0,      't'},
+        {"measure-cpu-freq",    no_argument,        0,      measure_cpu_freq_val},
 
         // latency flags
         {"lat-cpu",             required_argument,  0,      'l'},
+        {"lat-cpus",            required_argument,  0,      lat_cpus_val},
         {"lat-cacheline-count", required_argument,  0,      'n'},
         {"lat-secondary-delay", required_argument,  0,      'e'},
         {"lat-iterations",      required_argument,  0,      'i'},
@@ -173,9 +867,12 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
         {"lat-warmup-cpu",      required_argument,  0,      'w'},
         {"lat-shared-memory",   no_argument,        0,      's'},
         {"lat-shared-memory-init-cpu", required_argument, 0, 'u'},
+        {"lat-mem-node",        required_argument,  0,      lat_mem_node_val},
+        {"lat-chains",          required_argument,  0,      lat_chains_val},
 
         // bandwidth flags
         {"bw-cpu",              required_argument,  0,      'B'},
+        {"bw-cpus",             required_argument,  0,      bw_cpus_val},
         {"bw-iterations",       required_argument,  0,      'I'},
         {"bw-buflen",           required_argument,  0,      'L'},
         {"bw-fine-delay",       required_argument,  0,      'F'},
@@ -183,12 +880,38 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
         {"bw-use-hugepages",    required_argument,  0,      'H'},
         {"bw-cacheline-bytes",  required_argument,  0,      'Z'},
         {"bw-write",            no_argument,        0,      'W'},
+        {"bw-write-mode",       required_argument,  0,      bw_write_mode_val},
+        {"bw-mem-node",         required_argument,  0,      bw_mem_node_val},
+        {"bw-target-mbps",      required_argument,  0,      bw_target_mbps_val},
+        {"bw-target-mbps-per-thread", required_argument, 0, bw_target_mbps_per_thread_val},
+        {"bw-kernel",           required_argument,  0,      bw_kernel_val},
+        {"bw-prefetch-distance",required_argument,  0,      bw_prefetch_distance_val},
+        {"bw-kind",             required_argument,  0,      bw_kind_val},
+        {"bw-atomic-op",        required_argument,  0,      bw_atomic_op_val},
+        {"bw-atomic-lines",     required_argument,  0,      bw_atomic_lines_val},
+        {"bw-pattern",          required_argument,  0,      bw_pattern_val},
+
+        // multi-phase flags
+        {"sweep-fine-delay",    required_argument,  0,      sweep_fine_delay_val},
+        {"lat-sizes",           required_argument,  0,      lat_sizes_val},
+        {"bw-ramp",             required_argument,  0,      bw_ramp_val},
+
+        // core-to-core latency flags
+        {"c2c-cpus",            required_argument,  0,      c2c_cpus_val},
+        {"c2c-mode",            required_argument,  0,      c2c_mode_val},
+        {"c2c-iterations",      required_argument,  0,      c2c_iterations_val},
+
+        // output flags
+        {"output",              required_argument,  0,      output_val},
+        {"output-file",         required_argument,  0,      output_file_val},
+        {"live-samples",        no_argument,        0,      live_samples_val},
 
         {"help",                no_argument,        0,      help_val},
         {0,                     0,                  0,      0}
     };
 
     long cpu;
+    cpu_set_t cpus;     // CPUs of a --lat-cpus or --bw-cpus list
 
     while (1) {
 
@@ -218,17 +941,19 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
                 pargs->random_seedval = strtoul(optarg, NULL, 0);
                 break;
 
-            case delay_ticks_val: // --delay-ticks ticks : how many HWCOUNTER ticks to wait for threads to start
+            case delay_ticks_val: // --delay-ticks ticks : margin in HWCOUNTER ticks from the last thread being ready to the start
                 pargs->delay_ticks = strtoul(optarg, NULL, 0);
-                if (pargs->delay_seconds_valid) {
+                if (pargs->delay_seconds_set) {
                     printf("WARNING: --delay-ticks will override earlier --delay-seconds\n");
                 }
                 pargs->delay_seconds_valid = 0;
+                pargs->delay_seconds_set = 0;
                 break;
 
-            case 'd':  // --delay-seconds seconds       : how many seconds to wait for threads to start
+            case 'd':  // --delay-seconds seconds       : margin from the last thread being ready to the start
                 pargs->delay_seconds = strtod(optarg, NULL);
                 pargs->delay_seconds_valid = 1;
+                pargs->delay_seconds_set = 1;
                 break;
 
             case 'Q':  // --mitigate-spectre-v4 : using this flag can reduce performance
@@ -253,14 +978,22 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
                 pargs->mhz = 1e3/pargs->cycle_time_ns;
                 break;
 
+            case measure_cpu_freq_val:  // --measure-cpu-freq
+                pargs->measure_cpu_freq = 1;
+                break;
+
             case show_per_thread_concurrency_val:
                 pargs->show_per_thread_concurrency = 1;
                 break;
 
+            case perf_val:  // --perf
+                pargs->perf = 1;
+                break;
+
          // ---- lower case flags are for latency threads ---------------------------------------------------
-            case 'l':  // --lat-cpu cpu          : CPU on which to run a latency thread.  Repeat for each CPU.
-                cpu = strtol(optarg, NULL, 0);
-                if (CPU_ISSET(cpu, &pargs->lat_cpuset)) {
+            case 'l':  // --lat-cpu cpu[:override...] : CPU on which to run a latency thread.  Repeat for each CPU.
+                cpu = parse_thread_cpu(optarg, pargs, 0);
+                if (CPU_ISSET(cpu, &pargs->lat_cpuset) && ! strchr(optarg, ':')) {
                     printf("Warning: CPU%ld was already specified to run a latency thread, so extra -l is redundant.\n", cpu);
                 }
                 if (CPU_ISSET(cpu, &pargs->bw_cpuset)) {
@@ -269,6 +1002,19 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
                 CPU_SET(cpu, &pargs->lat_cpuset);
                 break;
 
+            case lat_cpus_val:  // --lat-cpus cpu_list      : CPUs on which to run latency threads
+                parse_cpu_list("--lat-cpus", optarg, NULL, &cpus);
+                for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                    if (CPU_ISSET(cpu, &cpus) && CPU_ISSET(cpu, &pargs->bw_cpuset)) {
+                        printf("Warning: CPU%ld was already specified to run a bandwidth thread, so this will double-up a latency thread on the same CPU.\n", cpu);
+                    }
+                }
+                CPU_OR(&pargs->lat_cpuset, &pargs->lat_cpuset, &cpus);
+                printf("--lat-cpus %s = ", optarg);
+                print_cpu_list(&cpus);
+                printf("\n");
+                break;
+
             case 'n':  // --lat-cacheline_count count : number of cachelines for the span of memory to use for latency measurement
                 pargs->lat_cacheline_count = strtoul(optarg, NULL, 0);
                 break;
@@ -321,14 +1067,26 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
                 pargs->lat_shared_memory = 1;
                 break;
 
-            case 'u':  // --lat-shared-memory-init-cpu cpu_num
-                pargs->lat_shared_memory_init_cpu = strtol(optarg, NULL, 0);
+            case 'u':  // --lat-shared-memory-init-cpu cpu_list : the memory is allocated from the lowest CPU
+                parse_cpu_list("-u", optarg, NULL, &pargs->lat_init_cpuset);
+                for (cpu = 0; ! CPU_ISSET(cpu, &pargs->lat_init_cpuset); cpu++) {
+                    ;
+                }
+                pargs->lat_shared_memory_init_cpu = cpu;
+                break;
+
+            case lat_mem_node_val:  // --lat-mem-node node[,node...]
+                pargs->lat_mem_node_count = parse_mem_node_list("lat-mem-node", optarg, pargs->lat_mem_nodes);
+                break;
+
+            case lat_chains_val:    // --lat-chains count
+                pargs->lat_chains = strtoul(optarg, NULL, 0);
                 break;
 
          // ---- upper case flags are for bandwidth ------------------------------------------------------------
-            case 'B':  // --bw-cpu cpu_num              : CPU on which to run a bandwidth thread.  Repeat for each CPU.
-                cpu = strtol(optarg, NULL, 0);
-                if (CPU_ISSET(cpu, &pargs->bw_cpuset)) {
+            case 'B':  // --bw-cpu cpu_num[:override...] : CPU on which to run a bandwidth thread.  Repeat for each CPU.
+                cpu = parse_thread_cpu(optarg, pargs, 1);
+                if (CPU_ISSET(cpu, &pargs->bw_cpuset) && ! strchr(optarg, ':')) {
                     printf("Warning: -B %ld was previously already specified\n", cpu);
                 }
                 if (CPU_ISSET(cpu, &pargs->lat_cpuset)) {
@@ -337,6 +1095,19 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
                 CPU_SET(cpu, &pargs->bw_cpuset);
                 break;
 
+            case bw_cpus_val:  // --bw-cpus cpu_list        : CPUs on which to run bandwidth threads; "lat" is the latency CPUs so far
+                parse_cpu_list("--bw-cpus", optarg, &pargs->lat_cpuset, &cpus);
+                for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                    if (CPU_ISSET(cpu, &cpus) && CPU_ISSET(cpu, &pargs->lat_cpuset)) {
+                        printf("Warning: CPU%ld was already specified to run a latency thread, so this will double-up a bandwidth thread on the same CPU.\n", cpu);
+                    }
+                }
+                CPU_OR(&pargs->bw_cpuset, &pargs->bw_cpuset, &cpus);
+                printf("--bw-cpus %s = ", optarg);
+                print_cpu_list(&cpus);
+                printf("\n");
+                break;
+
             case 'I':  // --bw-iterations iters         : bandwidth
                 pargs->bw_iterations = strtoul(optarg, NULL, 0);
                 break;
@@ -364,6 +1135,108 @@ void handle_args(int argc, char ** argv, args_t * pargs) {
 
             case 'W':  // --bw-write                    : use writes for memory bandwidth traffic
                 pargs->bw_write = 1;
+                pargs->bw_kind = BW_KIND_WRITE;
+                break;
+
+            case bw_write_mode_val: // --bw-write-mode mode    : kind of writes, implies --bw-write
+                pargs->bw_write_mode = parse_bw_write_mode_parameter(optarg);
+                pargs->bw_write = 1;
+                pargs->bw_kind = BW_KIND_WRITE;
+                break;
+
+            case bw_kind_val:       // --bw-kind read|write|atomic|copy|scale|add|triad
+                pargs->bw_kind = parse_bw_kind_parameter(optarg);
+                pargs->bw_write = pargs->bw_kind == BW_KIND_WRITE;
+                break;
+
+            case bw_atomic_op_val:  // --bw-atomic-op add|cas
+                pargs->bw_atomic_op = parse_bw_atomic_op_parameter(optarg);
+                break;
+
+            case bw_atomic_lines_val:  // --bw-atomic-lines count
+                pargs->bw_atomic_lines = strtoul(optarg, NULL, 0);
+                if (pargs->bw_atomic_lines == 0) {
+                    printf("ERROR: --bw-atomic-lines must be at least 1\n");
+                    exit(-1);
+                }
+                break;
+
+            case bw_mem_node_val:   // --bw-mem-node node[,node...]
+                pargs->bw_mem_node_count = parse_mem_node_list("bw-mem-node", optarg, pargs->bw_mem_nodes);
+                break;
+
+            case bw_target_mbps_val:    // --bw-target-mbps MB/sec  : total of all bandwidth threads
+                pargs->bw_target_mbps = strtod(optarg, NULL);
+                pargs->bw_target_per_thread = 0;
+                break;
+
+            case bw_target_mbps_per_thread_val:  // --bw-target-mbps-per-thread MB/sec
+                pargs->bw_target_mbps = strtod(optarg, NULL);
+                pargs->bw_target_per_thread = 1;
+                break;
+
+            case bw_kernel_val:     // --bw-kernel name
+                pargs->bw_kernel = parse_bw_kernel_parameter(optarg);
+                break;
+
+            case bw_pattern_val:    // --bw-pattern sequential|random|strided:bytes
+                parse_bw_pattern(optarg, pargs);
+                break;
+
+            case bw_prefetch_distance_val:  // --bw-prefetch-distance lines
+                pargs->bw_prefetch_lines = strtoul(optarg, NULL, 0);
+                break;
+
+         // ---- multi-phase flags ----------------------------------------------------------------------------
+            case sweep_fine_delay_val:  // --sweep-fine-delay count[,count...]
+                pargs->sweep_fine_delay_count = parse_count_list("sweep-fine-delay", optarg,
+                        pargs->sweep_fine_delays, MAX_SWEEP_STEPS);
+                break;
+
+            case lat_sizes_val:  // --lat-sizes size[,size...]
+                pargs->lat_size_count = parse_size_list("lat-sizes", optarg, pargs->lat_sizes, MAX_SWEEP_STEPS);
+                break;
+
+            case bw_ramp_val:       // --bw-ramp threads
+                pargs->bw_ramp_step = strtoul(optarg, NULL, 0);
+                if (pargs->bw_ramp_step == 0) {
+                    printf("ERROR: --bw-ramp must add at least one bandwidth thread per phase\n");
+                    exit(-1);
+                }
+                break;
+
+         // ---- core-to-core latency flags -------------------------------------------------------------------
+            case c2c_cpus_val:      // --c2c-cpus cpu_list
+                parse_cpu_list("--c2c-cpus", optarg, NULL, &cpus);
+                CPU_OR(&pargs->c2c_cpuset, &pargs->c2c_cpuset, &cpus);
+                printf("--c2c-cpus %s = ", optarg);
+                print_cpu_list(&cpus);
+                printf("\n");
+                break;
+
+            case c2c_mode_val:      // --c2c-mode store|atomic
+                pargs->c2c_mode = parse_c2c_mode_parameter(optarg);
+                break;
+
+            case c2c_iterations_val:  // --c2c-iterations count
+                pargs->c2c_iterations = strtoul(optarg, NULL, 0);
+                if (pargs->c2c_iterations == 0) {
+                    printf("ERROR: --c2c-iterations must be at least 1\n");
+                    exit(-1);
+                }
+                break;
+
+         // ---- output flags ---------------------------------------------------------------------------------
+            case output_val:        // --output json|csv
+                pargs->output_format = parse_output_format_parameter(optarg);
+                break;
+
+            case output_file_val:   // --output-file filename
+                pargs->output_file = optarg;
+                break;
+
+            case live_samples_val:  // --live-samples
+                pargs->live_samples = 1;
                 break;
 
         }
@@ -7,17 +7,42 @@
 #ifndef ARGS_H
 #define ARGS_H
 
+#define MAX_SWEEP_STEPS 256
+
+/* Per-CPU overrides of the bandwidth and latency settings, from
+   -B cpu:override... and -l cpu:override...  A field that is not
+   overridden is -1 (or 0 for the sizes and counts, which cannot be 0), and
+   the thread on that CPU uses the global setting. */
+
+struct bw_override {
+    int       set;                 // 1 if any -B override was given for this CPU
+    int       bw_kind;             // BW_KIND_*, or -1
+    size_t    bw_buflen;           // L=bytes, or 0
+    long      bw_inner_nops;       // F=count, or -1
+    long      bw_outer_nops;       // C=count, or -1
+    size_t    bw_iterations;       // I=iters, or 0
+};
+
+struct lat_override {
+    int       set;                 // 1 if any -l override was given for this CPU
+    size_t    lat_cacheline_count; // n=count, or 0
+    size_t    lat_cacheline_stride; // j=count, or 0
+};
+
 typedef struct {
     cpu_set_t lat_cpuset;
     cpu_set_t lat_warmup_cpuset;
     cpu_set_t bw_cpuset;
     double    duration;            // how long to run in seconds
     int show_per_thread_concurrency; // show the per-thread concurrency metrics
+    int       perf;                // count PMU events per interval with perf_event_open
     int       delay_seconds_valid; // 1 if delay_seconds is valid instead of delay_ticks
+    int       delay_seconds_set;   // 1 if delay_seconds was given with -d instead of defaulted
     size_t    delay_ticks;         // HWCOUNTER ticks for thread setup and init
     double    delay_seconds;       // delay in seconds
     double    cycle_time_ns;       // 2600 MHz
     double    mhz;
+    int       measure_cpu_freq;    // measure the core frequency of each latency interval instead of using mhz
     unsigned long hwclock_freq;    // frequency in Hz of the hwclock counter
     long estimate_hwclock_freq_cpu;  // cpu on which to estimate hwclock frequency
     long      int random_seedval;
@@ -34,7 +59,12 @@ typedef struct {
     int       lat_use_hugepages;   // use hugepages for latency
     int       lat_shared_memory;   // latency: share memory
     int       lat_shared_memory_init_cpu; // if not set will use lowest numbered CPU of latency threads
+    cpu_set_t lat_init_cpuset;     // CPUs to build the shared memory loop, lat_shared_memory_init_cpu first
     int       lat_clear_cache;     // default do not clear cache on latency loop initialization
+    int       lat_mem_node_count;  // number of entries in lat_mem_nodes; 0 means do not bind latency memory
+    int       lat_mem_nodes[CPU_SETSIZE];  // NUMA node for each latency thread, repeated if fewer than threads
+    struct lat_override lat_overrides[CPU_SETSIZE];  // per-CPU latency settings from -l cpu:override...
+    size_t    lat_chains;          // independent pointer chains per latency thread
 
     size_t    bw_buflen;
     size_t    bw_inner_nops;
@@ -43,6 +73,33 @@ typedef struct {
     size_t    bw_cacheline_bytes;  // cacheline size default is 64 bytes for bandwdith
     int       bw_use_hugepages;    // use hugepages for bandwidth
     int       bw_write;   // bw_write = 1 means to do writes for mem bandwidth instead of reads
+    int       bw_write_mode;       // BW_WRITE_* kind of writes when bw_write = 1
+    double    bw_target_mbps;      // target bandwidth in MB/sec, or 0 to use the fine and coarse delays as given
+    int       bw_target_per_thread; // 1 if bw_target_mbps is per thread instead of the total of all threads
+    int       bw_mem_node_count;   // number of entries in bw_mem_nodes; 0 means do not bind bandwidth memory
+    int       bw_mem_nodes[CPU_SETSIZE];   // NUMA node for each bandwidth thread, repeated if fewer than threads
+    struct bw_override bw_overrides[CPU_SETSIZE];    // per-CPU bandwidth settings from -B cpu:override...
+    int       bw_kernel;           // BW_KERNEL_* read kernel
+    size_t    bw_prefetch_lines;   // software prefetch distance in cache lines; 0 means no software prefetch
+    int       bw_kind;             // BW_KIND_* traffic; BW_KIND_WRITE if and only if bw_write = 1
+    int       bw_atomic_op;        // BW_ATOMIC_* operation for BW_KIND_ATOMIC
+    size_t    bw_atomic_lines;     // cache lines shared by the bandwidth threads for BW_KIND_ATOMIC
+    int       bw_pattern;          // BW_PATTERN_* order of the bandwidth accesses
+    size_t    bw_stride_bytes;     // bytes between accesses for BW_PATTERN_STRIDED
+
+    size_t    sweep_fine_delay_count;  // number of fine delays to sweep in-process; 0 means no sweep
+    size_t    sweep_fine_delays[MAX_SWEEP_STEPS];  // bandwidth fine delay (-F) for each phase of the sweep
+    size_t    lat_size_count;      // number of latency loop sizes to sweep in-process; 0 means no sweep
+    size_t    lat_sizes[MAX_SWEEP_STEPS];  // latency loop size in bytes for each phase of the sweep
+    size_t    bw_ramp_step;        // bandwidth threads added in each phase of the ramp; 0 means no ramp
+
+    cpu_set_t c2c_cpuset;          // CPUs of the core-to-core latency threads
+    int       c2c_mode;            // C2C_MODE_* cache line handoff
+    size_t    c2c_iterations;      // timed round trips per pair of c2c threads
+
+    int       output_format;       // OUTPUT_* format of the results file
+    const char * output_file;      // results file, or NULL for none
+    int       live_samples;        // print the interim samples while the threads run
 
 } args_t;
 
@@ -50,4 +107,18 @@ void handle_args(int argc, char ** argv, args_t * pargs);
 
 const char * hugepage_map (int enum_param_value);
 
+const char * bw_kernel_map (int enum_param_value);
+
+const char * bw_write_mode_map (int enum_param_value);
+
+const char * output_format_map (int enum_param_value);
+
+const char * bw_kind_map (int enum_param_value);
+
+const char * bw_atomic_op_map (int enum_param_value);
+
+const char * bw_pattern_map (int enum_param_value);
+
+const char * c2c_mode_map (int enum_param_value);
+
 #endif
@@ -29,62 +29,108 @@
 #endif
 
 #include "alloc.h"
+#include "phase.h"
+#include "stats.h"
+#include "perf.h"
+#include "bwkernels.h"
 #include "bandwidth.h"
 
 
-/* my_read() provides a variable read bandwidth.
-   Increasing inner_nops lowers the read bandwidth. */
-
-static void my_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes)
-    __attribute__((noinline));
-static void my_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes) {
-    size_t i, j, dummy;
+/* --bw-target-mbps pacing.  The inner nops between cache lines are adjusted
+   after every iteration of the buffer so that the time per cache line, as
+   measured by the hwcounter, approaches the time per cache line at the target
+   bandwidth.  The fractional part of the nop count is carried between
+   iterations so that the average nop count need not be an integer. */
+
+struct bw_pacer {
+    double target_line_ticks;   // hwcounter ticks per cache line at the target bandwidth
+    double nop_ticks;           // hwcounter ticks per inner nop
+    double pace;                // inner nops, as a real number
+    double residue;             // fractional nops carried to the next iteration
+};
+
+#define BW_PACER_GAIN 0.5       // fraction of the estimated correction applied per iteration
+
+/* The buffer is passed to the kernel in chunks of BW_STOP_CHUNK_BYTES so that
+   the stop_ctl is polled often regardless of --bw-buflen and --bw-iterations.
+   It is a multiple of every cache line size and vector length. */
+
+#define BW_STOP_CHUNK_BYTES (256 * 1024)
+
+/* With --bw-kind atomic, a chunk of the buffer stands for one atomic
+   operation per cache line of the chunk on the shared lines, so the
+   bandwidth of a sample is the operations per second times the cache line
+   size.  The STREAM kinds run the chunk at the same offset of each of their
+   arrays, mem[0] = c, mem[1] = a and mem[2] = b.  The random and strided
+   --bw-pattern kernels make one access per cache line of the chunk, anywhere
+   in the buffer, continuing from where the last chunk left off. */
+
+#define BW_STREAM_ARRAYS 3      // most arrays of a STREAM kind: c, a and b
+
+struct bw_loop {
+    bw_kernel_t kernel;                     // sequential reads or writes
+    bw_atomic_kernel_t atomic_kernel;       // NULL unless BW_KIND_ATOMIC
+    bw_stream_kernel_t stream_kernel;       // NULL unless a STREAM kind
+    bw_pattern_kernel_t pattern_kernel;     // NULL unless BW_PATTERN_RANDOM or BW_PATTERN_STRIDED
+    struct bw_pattern_state pattern;
+    void * mem[BW_STREAM_ARRAYS];
+};
+
+static void run_chunk(const struct bw_thread_info * bw_tinfo, struct bw_loop * loop,
+        size_t offset, size_t chunk, size_t inner_nops) {
+    void ** mem = loop->mem;
+
+    if (loop->atomic_kernel) {
+        loop->atomic_kernel(bw_tinfo->atomic_lines, bw_tinfo->atomic_line_count, chunk / bw_tinfo->bw_cacheline_bytes,
+                            inner_nops, bw_tinfo->bw_cacheline_bytes);
+    } else if (loop->stream_kernel) {
+        loop->stream_kernel((double *) ((char *) mem[0] + offset), (const double *) ((char *) mem[1] + offset),
+                            mem[2] ? (const double *) ((char *) mem[2] + offset) : NULL,
+                            chunk, inner_nops, bw_tinfo->bw_cacheline_bytes, bw_tinfo->prefetch_bytes);
+    } else if (loop->pattern_kernel) {
+        loop->pattern_kernel(mem[0], bw_tinfo->bw_buflen, chunk / bw_tinfo->bw_cacheline_bytes, &loop->pattern,
+                             inner_nops, bw_tinfo->bw_cacheline_bytes);
+    } else {
+        loop->kernel((void *) (((char *) mem[0]) + offset), chunk, inner_nops, bw_tinfo->bw_cacheline_bytes, bw_tinfo->prefetch_bytes);
+    }
+}
 
-    // this just reads one 64-bit dword from each cache lnie
-    for (i = 0; i < bytes; i += bw_cacheline_bytes) {
-#ifdef __aarch64__
-        asm volatile ("ldr %0, [%1, %2]" : "=r" (dummy): "r" (p), "r" (i));
-#endif
-#ifdef __x86_64__
-        asm volatile ("movq   (%1,%2,1), %0" : "=r" (dummy) : "r" (p), "r" (i));
-#endif
-        for (j = 0; j < inner_nops; j++) {
-            asm volatile ("");
+static double calibrate_nop_ticks(bw_kernel_t kernel, void * mem, size_t bw_cacheline_bytes) {
+    const size_t lines = 64;
+    const size_t nops = 4096;
+    unsigned long best = -1;
+
+    // the smallest of several runs over a few cached lines is the nop cost
+    for (int i = 0; i < 5; i++) {
+        unsigned long start_tick = read_hwcounter();
+        kernel(mem, lines * bw_cacheline_bytes, nops, bw_cacheline_bytes, 0);
+        unsigned long ticks = read_hwcounter() - start_tick;
+        if (ticks < best) {
+            best = ticks;
         }
     }
+
+    return best / (double) (lines * nops);
 }
 
+static size_t pacer_update(struct bw_pacer * pacer, size_t inner_nops, unsigned long ticks, size_t lines) {
+    double line_ticks = ticks / (double) lines;
+    double estimate = inner_nops + (pacer->target_line_ticks - line_ticks) / pacer->nop_ticks;
 
-/* my_write() provides a variable write bandwidth.
-   Increasing inner_nops lowers the write bandwidth. */
-
-static void my_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes)
-    __attribute__((noinline));
-static void my_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes) {
-
-// uncomment the next line to use DC ZVA instructions to do writes
-//#define USE_DCZVA
-
-#if defined(__aarch64__) && defined(USE_DCZVA)
-    // this just writes one 64-bit dword from each cache line, but is slower.
-    for (char * i = p; i < ((char *)p)+bytes; i += bw_cacheline_bytes) {
-        asm volatile ("dc zva, %0" : : "r" (i));
-#elif defined(__aarch64__) && !defined(USE_DCZVA)
-    size_t dummy=0;
-    for (size_t i = 0; i < bytes; i += bw_cacheline_bytes) {
-        asm volatile ("str %0, [%1, %2]" : : "r" (dummy), "r" (p), "r" (i));
-#elif defined(__x86_64__)
-    size_t dummy=0;
-    for (size_t i = 0; i < bytes; i += bw_cacheline_bytes) {
-        // warning untested
-        asm volatile ("movq   %0, (%1,%2,1)" : : "r" (dummy), "r" (p), "r" (i));
-#endif
-        for (size_t j = 0; j < inner_nops; j++) {
-            asm volatile ("");
-        }
+    pacer->pace += BW_PACER_GAIN * (estimate - pacer->pace);
+    if (pacer->pace < 0) {
+        pacer->pace = 0;
+    }
+
+    size_t nops = (size_t) pacer->pace;
+    pacer->residue += pacer->pace - nops;
+    if (pacer->residue >= 1.0) {
+        pacer->residue -= 1.0;
+        nops++;
     }
-}
 
+    return nops;
+}
 
 void bandwidth_thread (struct bw_thread_info * bw_tinfo) {
     size_t buflen           = bw_tinfo->bw_buflen;
@@ -95,63 +141,223 @@ void bandwidth_thread (struct bw_thread_info * bw_tinfo) {
     int thread_num          = bw_tinfo->thread_num;
     int cpu                 = bw_tinfo->cpu;                /* cpu on which this thread is to run */
     int bw_write            = bw_tinfo->bw_write;
+    int bw_write_mode       = bw_tinfo->bw_write_mode;
+    int bw_kernel           = bw_tinfo->bw_kernel;
+    size_t prefetch_bytes   = bw_tinfo->prefetch_bytes;
 
-    unsigned long hwcounter_start = bw_tinfo->hwcounter_start;
-    unsigned long hwcounter_stop  = bw_tinfo->hwcounter_stop;
+    unsigned long hwcounter_start, hwcounter_stop;
 
     size_t bw_cacheline_bytes     = bw_tinfo->bw_cacheline_bytes;
 
     int bw_use_hugepages    = bw_tinfo->bw_use_hugepages;
+    int mem_node            = bw_tinfo->mem_node;
+
+    struct phase_ctl * phase_ctl  = bw_tinfo->phase_ctl;
+    struct start_ctl * start_ctl  = bw_tinfo->start_ctl;
+    struct stop_ctl * stop_ctl    = bw_tinfo->stop_ctl;
+    int phase = 0;
+
+    double target_bw        = bw_tinfo->target_bw;
+    struct bw_pacer pacer = { 0 };
+    size_t buflen_lines     = (buflen + bw_cacheline_bytes - 1) / bw_cacheline_bytes;
+
+    struct bw_loop loop     = { 0 };
+
+    loop.kernel             = bw_write ? bw_write_kernel(bw_write_mode) : bw_read_kernel(bw_kernel);
+    loop.atomic_kernel      = bw_tinfo->bw_kind == BW_KIND_ATOMIC ? bw_atomic_kernel(bw_tinfo->atomic_op) : NULL;
+    loop.stream_kernel      = bw_stream_kernel(bw_tinfo->bw_kind);
+    loop.pattern_kernel     = bw_pattern_kernel(bw_tinfo->bw_pattern, bw_write, bw_write_mode);
+
+    // each thread has its own random sequence, repeatable with --random-seed
+    loop.pattern.rng        = bw_tinfo->random_seed * 2654435761UL + thread_num + 1;
+    loop.pattern.stride     = bw_tinfo->bw_stride_bytes;
+    int streams             = bw_tinfo->read_streams + bw_tinfo->write_streams;
 
     unsigned long start_tick, stop_tick, tickdiff;
-    double avg_bw = 0.0;
+    double avg_bw;
     double cntfreq = (double) read_cntfreq();
-    unsigned long bw_samples = 0;
+    unsigned long bw_samples;
+
+    printf("CPU%d BWTHREAD%d: buflen = %zu, iterations = %zu, inner_nops = %zu, outer_nops = %zu, bw_cacheline_bytes = %zu, bw_use_hugepages = %d, mem_node = %d, kernel = %s, pattern = %s, prefetch_bytes = %zu, tid = %d\n",
+           cpu, thread_num, buflen, iterations, inner_nops, outer_nops, bw_cacheline_bytes, bw_use_hugepages, mem_node,
+           loop.atomic_kernel ? bw_atomic_op_map(bw_tinfo->atomic_op) : loop.stream_kernel ? bw_kind_map(bw_tinfo->bw_kind) :
+           bw_write ? bw_write_mode_map(bw_write_mode) : bw_kernel_map(bw_kernel),
+           bw_pattern_map(bw_tinfo->bw_pattern), prefetch_bytes, gettid());
+
+    char label[64];
+    void ** mem = loop.mem;
+
+    // the atomic operations are on the shared lines, so there is no buffer to sweep
+    for (int s = 0; loop.atomic_kernel == NULL && s < (loop.stream_kernel ? streams : 1); s++) {
+        mem[s] = do_alloc(buflen, bw_use_hugepages, sysconf(_SC_PAGESIZE), mem_node);
+
+        if (loop.stream_kernel) {
+            // start from normal doubles, since do_alloc() fills the arrays with bytes of 1
+            for (size_t i = 0; i < buflen / sizeof(double); i++) {
+                ((double *) mem[s])[i] = 1.0;
+            }
+            snprintf(label, sizeof(label), "CPU%d BWTHREAD%d: memory %c", cpu, thread_num, "cab"[s]);
+        } else {
+            snprintf(label, sizeof(label), "CPU%d BWTHREAD%d: memory", cpu, thread_num);
+        }
+        report_mem_nodes(label, mem[s], buflen);
+    }
+
+    unsigned long counts[SAMPLE_MAX_COUNTERS];
+
+    if (bw_tinfo->perf) {
+        snprintf(label, sizeof(label), "CPU%d BWTHREAD%d", cpu, thread_num);
+        perf_open(&bw_tinfo->perf_group, label);
+    }
+
+    if (target_bw > 0) {
+        // each line of an iteration moves a line of every stream
+        pacer.target_line_ticks = cntfreq * bw_cacheline_bytes * streams / target_bw;
+        pacer.nop_ticks = calibrate_nop_ticks(loop.stream_kernel ? bw_read_kernel(BW_KERNEL_SCALAR) : loop.kernel, mem[0], bw_cacheline_bytes);
+        pacer.pace = inner_nops;
+        pacer.residue = 0;
+
+        printf("CPU%d BWTHREAD%d: target = %f MB/sec, %f " HWCOUNTER " ticks per line, %f ticks per nop\n",
+               cpu, thread_num, target_bw / 1e6, pacer.target_line_ticks, pacer.nop_ticks);
+    }
+
+    // tell the main thread that this thread is ready, and wait for it to publish the start
+
+    start_ready(start_ctl);
 
-    printf("CPU%d BWTHREAD%d: buflen = %zu, iterations = %zu, inner_nops = %zu, outer_nops = %zu, hwcounter_start = 0x%zx, bw_cacheline_bytes = %zu, bw_use_hugepages = %d, tid = %d\n",
-           cpu, thread_num, buflen, iterations, inner_nops, outer_nops, hwcounter_start, bw_cacheline_bytes, bw_use_hugepages, gettid());
+    /* With --bw-ramp, the threads after the first bw_active_threads sit out
+       the phases until they are activated, without loading memory.  The
+       main thread leaves them out of the stop_ctl of those phases.  Once
+       active, a thread stays active. */
 
-    void * mem = do_alloc(buflen, bw_use_hugepages, sysconf(_SC_PAGESIZE));
+    while (phase_ctl && thread_num >= phase_ctl->bw_active_threads) {
+        if (! phase_wait_next(phase_ctl, &phase)) {
+            return;
+        }
+    }
+
+    if (phase == 0) {
+        hwcounter_start = bw_tinfo->hwcounter_start = start_ctl->hwcounter_start;
+        hwcounter_stop  = bw_tinfo->hwcounter_stop  = start_ctl->hwcounter_stop;
+    } else {
+        hwcounter_start = bw_tinfo->hwcounter_start = phase_ctl->hwcounter_start;
+        hwcounter_stop  = bw_tinfo->hwcounter_stop  = phase_ctl->hwcounter_stop;
 
-    // synchronize thread start at the specified HW timer value
-    while ((start_tick = read_hwcounter()) < hwcounter_start) {
-        ;
+        printf("CPU%d BWTHREAD%d: activated in phase %d, hwcounter_start = 0x%zx\n",
+               cpu, thread_num, phase, hwcounter_start);
     }
 
-    bw_tinfo->actual_hwcounter_start = start_tick;
+    // each pass of this loop is one phase; there is only one unless phase_ctl is used
+
+    while (1) {
+
+        avg_bw = 0.0;
+        bw_samples = 0;
+
+        // synchronize thread start at the specified HW timer value
+        while ((start_tick = read_hwcounter()) < hwcounter_start) {
+            ;
+        }
+
+        bw_tinfo->actual_hwcounter_start = start_tick;
+
+        printf("CPU%d BWTHREAD%d: started at " HWCOUNTER " = 0x%zx\n", cpu, thread_num, start_tick);
 
-    printf("CPU%d BWTHREAD%d: started at " HWCOUNTER " = 0x%zx\n", cpu, thread_num, start_tick);
+        int stopped = 0;
 
-    while ((start_tick = stop_tick = read_hwcounter()) < hwcounter_stop) {
+        while (! stopped) {
 
-        for (size_t i = 0; i < iterations; i++) {
-            if (bw_write) {
-                my_write((void *) (((char *) mem)), buflen, inner_nops, bw_cacheline_bytes);
-            } else {
-                my_read((void *) (((char *) mem)), buflen, inner_nops, bw_cacheline_bytes);
+            size_t bytes = 0;
+
+            // the perf group is read outside of the timed interval, as in the latency threads
+            perf_start(&bw_tinfo->perf_group);
+
+            if ((start_tick = stop_tick = read_hwcounter()) >= hwcounter_stop) {
+                break;
             }
-            for (size_t j = 0; j < outer_nops; j++) {
-                asm volatile ("");
+
+            for (size_t i = 0; i < iterations && ! stopped; i++) {
+                unsigned long pass_tick = target_bw > 0 ? read_hwcounter() : 0;
+
+                for (size_t offset = 0; offset < buflen; offset += BW_STOP_CHUNK_BYTES) {
+                    size_t chunk = buflen - offset < BW_STOP_CHUNK_BYTES ? buflen - offset : BW_STOP_CHUNK_BYTES;
+
+                    run_chunk(bw_tinfo, &loop, offset, chunk, inner_nops);
+                    bytes += chunk * streams;
+
+                    if (stop_check(stop_ctl, read_hwcounter(), hwcounter_stop)) {
+                        stopped = 1;
+                        break;
+                    }
+                }
+
+                for (size_t j = 0; j < outer_nops; j++) {
+                    asm volatile ("");
+                }
+
+                // a pass cut short by the stop is not a whole pass to pace by
+                if (target_bw > 0 && ! stopped) {
+                    inner_nops = pacer_update(&pacer, inner_nops, read_hwcounter() - pass_tick, buflen_lines);
+                }
             }
+
+            stop_tick = read_hwcounter();
+
+            perf_stop(&bw_tinfo->perf_group, counts);
+
+            tickdiff = stop_tick - start_tick;
+
+            // the last sample may be short because of the stop
+            double bw = bytes / (tickdiff / cntfreq);
+
+            avg_bw += bw;
+            bw_samples++;
+
+            // the main thread prints the sample, so that printf is not in the measurement
+            sample_ring_push(&bw_tinfo->ring, start_tick, stop_tick, bw, 0.0, counts);
         }
 
-        stop_tick = read_hwcounter();
-        tickdiff = stop_tick - start_tick;
+        bw_tinfo->actual_hwcounter_stop = stop_tick;
 
-        double bw = iterations * buflen / (tickdiff / cntfreq);
+        // keep loading memory until every thread has stopped measuring
+        stop_arrive(stop_ctl);
+        while (stop_draining(stop_ctl)) {
+            run_chunk(bw_tinfo, &loop, 0, buflen < BW_STOP_CHUNK_BYTES ? buflen : BW_STOP_CHUNK_BYTES, inner_nops);
+        }
 
-        avg_bw += bw;
-        bw_samples++;
+        avg_bw /= bw_samples;
 
-        bw /= 1e6;  // MB, not MiB
+        bw_tinfo->avg_bw = avg_bw;
 
-        printf("CPU%d BWTHREAD%d: %f MB/sec\n", cpu, thread_num, bw);
+        if (target_bw > 0) {
+            printf("CPU%d BWTHREAD%d: paced to %f inner nops for target %f MB/sec\n",
+                   cpu, thread_num, pacer.pace, target_bw / 1e6);
+        }
 
-    }
+        if (phase_ctl == NULL || ! phase_wait_next(phase_ctl, &phase)) {
+            break;
+        }
+
+        hwcounter_start = bw_tinfo->hwcounter_start = phase_ctl->hwcounter_start;
+        hwcounter_stop  = bw_tinfo->hwcounter_stop  = phase_ctl->hwcounter_stop;
+
+        // a paced thread keeps its pace, since the fine delay is only swept without a target
+        if (target_bw == 0) {
+            inner_nops  = bw_tinfo->inner_nops      = phase_ctl->bw_inner_nops;
+        }
 
-    bw_tinfo->actual_hwcounter_stop = stop_tick;
+        printf("CPU%d BWTHREAD%d: phase %d, inner_nops = %zu, hwcounter_start = 0x%zx\n",
+               cpu, thread_num, phase, inner_nops, hwcounter_start);
+    }
 
-    avg_bw /= bw_samples;
+    perf_close(&bw_tinfo->perf_group);
+}
 
-    bw_tinfo->avg_bw = avg_bw;
+int bw_pattern_updates(const struct bw_thread_info * bw_tinfo, int num_bw_threads) {
+    for (int i = 0; i < num_bw_threads; i++) {
+        if (! bw_tinfo[i].bw_write) {
+            return 0;
+        }
+    }
+    return num_bw_threads > 0;
 }
@@ -9,8 +9,8 @@
 
 struct bw_thread_info {
     pthread_t     thread_id;
-    unsigned long hwcounter_start;
-    unsigned long hwcounter_stop;
+    unsigned long hwcounter_start;  // output: published start
+    unsigned long hwcounter_stop;   // output: published stop
     unsigned long actual_hwcounter_start;   // output
     unsigned long actual_hwcounter_stop;    // output
     int           thread_num;
@@ -21,12 +21,40 @@ struct bw_thread_info {
     size_t        iterations;
     size_t        bw_cacheline_bytes;
     int           bw_use_hugepages;
+    int           mem_node;         // NUMA node to bind memory to, or MEM_NODE_NONE
     int           bw_write;
+    int           bw_write_mode;    // BW_WRITE_*, used if bw_write = 1
+    int           bw_kernel;        // BW_KERNEL_*, already resolved from BW_KERNEL_AUTO
+    int           bw_kind;          // BW_KIND_*
+    int           read_streams;     // buffers read per line of an iteration, from bw_kind_streams()
+    int           write_streams;    // buffers written per line of an iteration
+    int           atomic_op;        // BW_ATOMIC_*, used if bw_kind = BW_KIND_ATOMIC
+    void *        atomic_lines;     // BW_KIND_ATOMIC: cache lines shared by all bandwidth threads, instead of a buffer
+    size_t        atomic_line_count;
+    size_t        prefetch_bytes;   // software prefetch distance; 0 for none
+    int           bw_pattern;       // BW_PATTERN_* order of the cache lines of the buffer
+    size_t        bw_stride_bytes;  // BW_PATTERN_STRIDED: bytes from one access to the next
+    long          random_seed;      // seeds the BW_PATTERN_RANDOM sequence of this thread
+    double        target_bw;        // bytes/sec to pace inner_nops to; 0 means use inner_nops as given
     double        avg_bw;                   // output
+    struct sample_ring ring;                // interim bandwidth samples in bytes/sec, to the main thread
+    struct sample_buf samples;              // output: interim bandwidth samples, collected by the main thread
+    struct window_stats window;             // output: samples in the concurrent window, set by the main thread
+    int           finished;                 // output: set when the thread returns (atomic)
+    int           perf;                     // count --perf events per interval
+    struct perf_group perf_group;           // output: the --perf events, opened by the thread
+    struct phase_ctl * phase_ctl;           // NULL unless running multiple phases
+    struct start_ctl * start_ctl;           // shared by all threads to start together
+    struct stop_ctl * stop_ctl;             // shared by all threads to stop together
     char          threadname[32];
 };
 
 
 void bandwidth_thread (struct bw_thread_info * bw_tinfo);
 
+/* bw_pattern_updates() is 1 if every one of the threads writes, so that the
+   accesses of a --bw-pattern are reported as updates, or 0 if any only reads */
+
+int bw_pattern_updates(const struct bw_thread_info * bw_tinfo, int num_bw_threads);
+
 #endif
@@ -0,0 +1,588 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#ifdef __aarch64__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "args.h"
+#include "bwkernels.h"
+
+
+#define NOP_DELAY(inner_nops)                                                       \
+    for (size_t j = 0; j < (inner_nops); j++) {                                     \
+        asm volatile ("");                                                          \
+    }
+
+/* LINE_LOOP runs ACCESS (which uses p + i) for each cache line.  The loop
+   without prefetch is kept separate so that it has no extra instructions. */
+
+#define LINE_LOOP(prefetch_rw, ACCESS)                                              \
+    if (prefetch_bytes) {                                                           \
+        for (size_t i = 0; i < bytes; i += bw_cacheline_bytes) {                    \
+            __builtin_prefetch((char *) p + i + prefetch_bytes, prefetch_rw, 3);    \
+            ACCESS;                                                                 \
+            NOP_DELAY(inner_nops);                                                  \
+        }                                                                           \
+    } else {                                                                        \
+        for (size_t i = 0; i < bytes; i += bw_cacheline_bytes) {                    \
+            ACCESS;                                                                 \
+            NOP_DELAY(inner_nops);                                                  \
+        }                                                                           \
+    }
+
+
+/* my_read() provides a variable read bandwidth.
+   Increasing inner_nops lowers the read bandwidth. */
+
+static void my_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void my_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t dummy;
+
+    // this just reads one 64-bit dword from each cache line
+#ifdef __aarch64__
+    LINE_LOOP(0, asm volatile ("ldr %0, [%1, %2]" : "=r" (dummy): "r" (p), "r" (i)));
+#endif
+#ifdef __x86_64__
+    LINE_LOOP(0, asm volatile ("movq   (%1,%2,1), %0" : "=r" (dummy) : "r" (p), "r" (i)));
+#endif
+}
+
+
+/* The SIMD read kernels read every byte of each cache line. */
+
+#ifdef __aarch64__
+
+#define NEON_BYTES 32   // bytes per ldp of two q registers
+
+static void neon_read_line(const char * line, size_t bw_cacheline_bytes) {
+    for (size_t o = 0; o < bw_cacheline_bytes; o += NEON_BYTES) {
+        asm volatile ("ldp q0, q1, [%0]" : : "r" (line + o) : "v0", "v1");
+    }
+}
+
+static void neon_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void neon_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    LINE_LOOP(0, neon_read_line((char *) p + i, bw_cacheline_bytes));
+}
+
+// SVE vector length in bytes; only valid if HWCAP_SVE is set
+
+static size_t sve_vector_bytes(void) {
+    size_t vl;
+    asm volatile (".arch_extension sve\n\tcntb %0" : "=r" (vl));
+    return vl;
+}
+
+static void sve_read_line(const char * line, size_t bw_cacheline_bytes, size_t vl) {
+    for (size_t o = 0; o < bw_cacheline_bytes; o += vl) {
+        // the unpredicated LDR (vector) loads one full vector without needing a predicate register
+        asm volatile (".arch_extension sve\n\tldr z0, [%0]" : : "r" (line + o) : "v0");
+    }
+}
+
+static void sve_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void sve_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t vl = sve_vector_bytes();
+    LINE_LOOP(0, sve_read_line((char *) p + i, bw_cacheline_bytes, vl));
+}
+
+#endif
+
+#ifdef __x86_64__
+
+#define AVX2_BYTES   32
+#define AVX512_BYTES 64
+
+static void avx2_read_line(const char * line, size_t bw_cacheline_bytes) {
+    for (size_t o = 0; o < bw_cacheline_bytes; o += AVX2_BYTES) {
+        asm volatile ("vmovdqu (%0), %%ymm0" : : "r" (line + o) : "xmm0");
+    }
+}
+
+static void avx2_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void avx2_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    LINE_LOOP(0, avx2_read_line((char *) p + i, bw_cacheline_bytes));
+    asm volatile ("vzeroupper");    // avoid AVX-SSE transition penalties in the caller
+}
+
+static void avx512_read_line(const char * line, size_t bw_cacheline_bytes) {
+    for (size_t o = 0; o < bw_cacheline_bytes; o += AVX512_BYTES) {
+        asm volatile ("vmovdqu64 (%0), %%zmm0" : : "r" (line + o) : "xmm0");
+    }
+}
+
+static void avx512_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void avx512_read(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    LINE_LOOP(0, avx512_read_line((char *) p + i, bw_cacheline_bytes));
+    asm volatile ("vzeroupper");
+}
+
+#endif
+
+
+/* my_write() provides a variable write bandwidth.
+   Increasing inner_nops lowers the write bandwidth. */
+
+static void my_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void my_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t dummy=0;
+
+    // this just writes one 64-bit dword to each cache line
+#ifdef __aarch64__
+    LINE_LOOP(1, asm volatile ("str %0, [%1, %2]" : : "r" (dummy), "r" (p), "r" (i)));
+#endif
+#ifdef __x86_64__
+    LINE_LOOP(1, asm volatile ("movq   %0, (%1,%2,1)" : : "r" (dummy), "r" (p), "r" (i)));
+#endif
+}
+
+
+/* rmw_write() reads and then writes back one 64-bit dword of each cache
+   line, so each line is read (RFO) before it is modified and written back. */
+
+static void rmw_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void rmw_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t dummy;
+
+#ifdef __aarch64__
+    LINE_LOOP(1, asm volatile ("ldr %0, [%1, %2]\n\t"
+                               "add %0, %0, #1\n\t"
+                               "str %0, [%1, %2]" : "=&r" (dummy) : "r" (p), "r" (i)));
+#endif
+#ifdef __x86_64__
+    LINE_LOOP(1, asm volatile ("movq   (%1,%2,1), %0\n\t"
+                               "addq   $1, %0\n\t"
+                               "movq   %0, (%1,%2,1)" : "=&r" (dummy) : "r" (p), "r" (i)));
+#endif
+}
+
+
+/* nt_write() writes every byte of each cache line with non-temporal stores,
+   which are not expected to allocate the line in the caches. */
+
+static void nt_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void nt_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t dummy=0;
+
+#ifdef __aarch64__
+    // STNP writes a pair of 64-bit registers
+    LINE_LOOP(1, for (size_t o = 0; o < bw_cacheline_bytes; o += 16) {
+                     asm volatile ("stnp %0, %0, [%1]" : : "r" (dummy), "r" ((char *) p + i + o));
+                 });
+#endif
+#ifdef __x86_64__
+    LINE_LOOP(1, for (size_t o = 0; o < bw_cacheline_bytes; o += 8) {
+                     asm volatile ("movnti %0, (%1)" : : "r" (dummy), "r" ((char *) p + i + o));
+                 });
+    asm volatile ("sfence" : : : "memory");    // drain the write-combining buffers
+#endif
+}
+
+
+#ifdef __aarch64__
+
+/* DC ZVA zeroes a whole block, whose size DCZID_EL0 gives as log2 of the
+   number of 4-byte words.  DCZID_EL0.DZP set means DC ZVA is prohibited. */
+
+#define DCZID_DZP   (1 << 4)
+
+static size_t dczva_block_bytes(void) {
+    size_t dczid;
+    asm volatile ("mrs %0, dczid_el0" : "=r" (dczid));
+    if (dczid & DCZID_DZP) {
+        return 0;
+    }
+    return 4 << (dczid & 0xf);
+}
+
+static void dczva_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void dczva_write(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    size_t block = dczva_block_bytes();
+
+    LINE_LOOP(1, for (size_t o = 0; o < bw_cacheline_bytes; o += block) {
+                     asm volatile ("dc zva, %0" : : "r" ((char *) p + i + o));
+                 });
+}
+
+#endif
+
+
+/* The atomic kernels operate on cache lines that every bandwidth thread
+   shares, so the operations contend for the lines as on a shared counter or
+   reference count.  Each operation is a single atomic instruction (or a CAS
+   retried until it succeeds), which an interconnect may execute at the home
+   node of the line rather than in the core. */
+
+#define ATOMIC_LOOP(ACCESS)                                                         \
+    size_t k = 0;                                                                   \
+    for (size_t i = 0; i < ops; i++) {                                              \
+        char * line = (char *) lines + k * bw_cacheline_bytes;                      \
+        ACCESS;                                                                     \
+        if (++k == line_count) {                                                    \
+            k = 0;                                                                  \
+        }                                                                           \
+        NOP_DELAY(inner_nops);                                                      \
+    }
+
+static void add_atomic(void * lines, size_t line_count, size_t ops, size_t inner_nops, size_t bw_cacheline_bytes)
+    __attribute__((noinline));
+static void add_atomic(void * lines, size_t line_count, size_t ops, size_t inner_nops, size_t bw_cacheline_bytes) {
+    size_t old;
+
+#ifdef __aarch64__
+    ATOMIC_LOOP(asm volatile (".arch_extension lse\n\tldadd %1, %0, [%2]" : "=r" (old) : "r" (1UL), "r" (line) : "memory"));
+#endif
+#ifdef __x86_64__
+    ATOMIC_LOOP(old = 1; asm volatile ("lock xaddq %0, (%1)" : "+r" (old) : "r" (line) : "memory"));
+#endif
+}
+
+static void cas_atomic(void * lines, size_t line_count, size_t ops, size_t inner_nops, size_t bw_cacheline_bytes)
+    __attribute__((noinline));
+static void cas_atomic(void * lines, size_t line_count, size_t ops, size_t inner_nops, size_t bw_cacheline_bytes) {
+    size_t expected, seen;
+
+    // a failed CAS returns the value that another thread stored, to retry with
+#ifdef __aarch64__
+    ATOMIC_LOOP(seen = *(volatile size_t *) line;
+                do {
+                    expected = seen;
+                    asm volatile (".arch_extension lse\n\tcas %0, %2, [%1]" : "+r" (seen) : "r" (line), "r" (expected + 1) : "memory");
+                } while (seen != expected));
+#endif
+#ifdef __x86_64__
+    ATOMIC_LOOP(seen = *(volatile size_t *) line;
+                do {
+                    expected = seen;
+                    asm volatile ("lock cmpxchgq %2, (%1)" : "+a" (seen) : "r" (line), "r" (expected + 1) : "memory", "cc");
+                } while (seen != expected));
+#endif
+}
+
+
+/* The --bw-pattern kernels.  The random offsets come from an xorshift64
+   generator, scaled to the cache lines of the buffer with a multiply rather
+   than a divide.  The strided offsets wrap to the next cache line after the
+   end of the buffer, so that every line is accessed once per pass when the
+   stride is a multiple of the cache line size. */
+
+static inline size_t random_offset(struct bw_pattern_state * state, size_t lines, size_t bw_cacheline_bytes) {
+    unsigned long x = state->rng;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    state->rng = x;
+
+    return (size_t) (((unsigned __int128) x * lines) >> 64) * bw_cacheline_bytes;
+}
+
+static inline size_t strided_offset(struct bw_pattern_state * state, size_t limit, size_t bw_cacheline_bytes) {
+    size_t i = state->offset;
+
+    state->offset += state->stride;
+    if (state->offset >= limit) {
+        state->column += bw_cacheline_bytes;
+        if (state->column >= state->stride || state->column >= limit) {
+            state->column = 0;
+        }
+        state->offset = state->column;
+    }
+
+    return i;
+}
+
+#define PATTERN_LOOP(NEXT, ACCESS)                                                  \
+    size_t lines = buflen / bw_cacheline_bytes;                                     \
+    size_t limit = lines * bw_cacheline_bytes;                                      \
+    (void) limit;                                                                   \
+    for (size_t n = 0; n < accesses; n++) {                                         \
+        size_t i = NEXT;                                                            \
+        ACCESS;                                                                     \
+        NOP_DELAY(inner_nops);                                                      \
+    }
+
+#ifdef __aarch64__
+#define PATTERN_READ    asm volatile ("ldr %0, [%1, %2]" : "=r" (dummy): "r" (p), "r" (i))
+#define PATTERN_STORE   asm volatile ("str %0, [%1, %2]" : : "r" (dummy), "r" (p), "r" (i))
+#define PATTERN_UPDATE  asm volatile ("ldr %0, [%1, %2]\n\t"                       \
+                                      "add %0, %0, #1\n\t"                         \
+                                      "str %0, [%1, %2]" : "=&r" (dummy) : "r" (p), "r" (i))
+#endif
+#ifdef __x86_64__
+#define PATTERN_READ    asm volatile ("movq   (%1,%2,1), %0" : "=r" (dummy) : "r" (p), "r" (i))
+#define PATTERN_STORE   asm volatile ("movq   %0, (%1,%2,1)" : : "r" (dummy), "r" (p), "r" (i))
+#define PATTERN_UPDATE  asm volatile ("movq   (%1,%2,1), %0\n\t"                   \
+                                      "addq   $1, %0\n\t"                          \
+                                      "movq   %0, (%1,%2,1)" : "=&r" (dummy) : "r" (p), "r" (i))
+#endif
+
+#define PATTERN_KERNEL(name, NEXT, ACCESS)                                          \
+    static void name(void * p, size_t buflen, size_t accesses, struct bw_pattern_state * state,    \
+                     size_t inner_nops, size_t bw_cacheline_bytes)                  \
+        __attribute__((noinline));                                                  \
+    static void name(void * p, size_t buflen, size_t accesses, struct bw_pattern_state * state,    \
+                     size_t inner_nops, size_t bw_cacheline_bytes) {                \
+        size_t dummy = 0;                                                           \
+        PATTERN_LOOP(NEXT, ACCESS);                                                 \
+    }
+
+PATTERN_KERNEL(random_read,     random_offset(state, lines, bw_cacheline_bytes),    PATTERN_READ)
+PATTERN_KERNEL(random_store,    random_offset(state, lines, bw_cacheline_bytes),    PATTERN_STORE)
+PATTERN_KERNEL(random_update,   random_offset(state, lines, bw_cacheline_bytes),    PATTERN_UPDATE)
+PATTERN_KERNEL(strided_read,    strided_offset(state, limit, bw_cacheline_bytes),   PATTERN_READ)
+PATTERN_KERNEL(strided_store,   strided_offset(state, limit, bw_cacheline_bytes),   PATTERN_STORE)
+PATTERN_KERNEL(strided_update,  strided_offset(state, limit, bw_cacheline_bytes),   PATTERN_UPDATE)
+
+
+/* The STREAM kernels mix read and write streams over separate arrays, as
+   in John McCalpin's STREAM benchmark, but with the fine delay and prefetch
+   of the other kernels between cache lines.  They are plain C, so the
+   compiler chooses the loads and stores. */
+
+#define STREAM_SCALAR 3.0
+
+#define STREAM_LOOP(ACCESS)                                                         \
+    size_t line_doubles = bw_cacheline_bytes / sizeof(double);                      \
+    size_t prefetch_doubles = prefetch_bytes / sizeof(double);                      \
+    size_t n = bytes / sizeof(double);                                              \
+    for (size_t i = 0; i < n; i += line_doubles) {                                  \
+        if (prefetch_doubles) {                                                     \
+            __builtin_prefetch(a + i + prefetch_doubles, 0, 3);                     \
+            if (b) {                                                                \
+                __builtin_prefetch(b + i + prefetch_doubles, 0, 3);                 \
+            }                                                                       \
+            __builtin_prefetch(c + i + prefetch_doubles, 1, 3);                     \
+        }                                                                           \
+        for (size_t o = i; o < i + line_doubles && o < n; o++) {                    \
+            ACCESS;                                                                 \
+        }                                                                           \
+        NOP_DELAY(inner_nops);                                                      \
+    }
+
+static void copy_stream(double * c, const double * a, const double * b, size_t bytes,
+                        size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void copy_stream(double * c, const double * a, const double * b, size_t bytes,
+                        size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    STREAM_LOOP(c[o] = a[o]);
+}
+
+static void scale_stream(double * c, const double * a, const double * b, size_t bytes,
+                         size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void scale_stream(double * c, const double * a, const double * b, size_t bytes,
+                         size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    STREAM_LOOP(c[o] = STREAM_SCALAR * a[o]);
+}
+
+static void add_stream(double * c, const double * a, const double * b, size_t bytes,
+                       size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void add_stream(double * c, const double * a, const double * b, size_t bytes,
+                       size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    STREAM_LOOP(c[o] = a[o] + b[o]);
+}
+
+static void triad_stream(double * c, const double * a, const double * b, size_t bytes,
+                         size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes)
+    __attribute__((noinline));
+static void triad_stream(double * c, const double * a, const double * b, size_t bytes,
+                         size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes) {
+    STREAM_LOOP(c[o] = a[o] + STREAM_SCALAR * b[o]);
+}
+
+
+int bw_kernel_supported(int kernel, size_t bw_cacheline_bytes) {
+    switch (kernel) {
+        case BW_KERNEL_SCALAR:
+            return 1;
+#ifdef __aarch64__
+        case BW_KERNEL_NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_ASIMD) && bw_cacheline_bytes % NEON_BYTES == 0;
+        case BW_KERNEL_SVE:
+            return (getauxval(AT_HWCAP) & HWCAP_SVE) && bw_cacheline_bytes % sve_vector_bytes() == 0;
+#endif
+#ifdef __x86_64__
+        case BW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") && bw_cacheline_bytes % AVX2_BYTES == 0;
+        case BW_KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f") && bw_cacheline_bytes % AVX512_BYTES == 0;
+#endif
+    }
+    return 0;
+}
+
+int bw_kernel_select(int kernel, size_t bw_cacheline_bytes) {
+
+    if (kernel == BW_KERNEL_AUTO) {
+        // widest first
+        static const int preference[] = {
+            BW_KERNEL_SVE, BW_KERNEL_NEON, BW_KERNEL_AVX512, BW_KERNEL_AVX2, BW_KERNEL_SCALAR
+        };
+
+        for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+            if (bw_kernel_supported(preference[i], bw_cacheline_bytes)) {
+                return preference[i];
+            }
+        }
+    }
+
+    if (! bw_kernel_supported(kernel, bw_cacheline_bytes)) {
+        printf("ERROR: bandwidth kernel %s is not supported on this CPU with bw_cacheline_bytes = %zu\n",
+                bw_kernel_map(kernel), bw_cacheline_bytes);
+        exit(-1);
+    }
+
+    return kernel;
+}
+
+bw_kernel_t bw_read_kernel(int kernel) {
+    switch (kernel) {
+#ifdef __aarch64__
+        case BW_KERNEL_NEON:
+            return neon_read;
+        case BW_KERNEL_SVE:
+            return sve_read;
+#endif
+#ifdef __x86_64__
+        case BW_KERNEL_AVX2:
+            return avx2_read;
+        case BW_KERNEL_AVX512:
+            return avx512_read;
+#endif
+    }
+    return my_read;
+}
+
+int bw_write_mode_supported(int mode, size_t bw_cacheline_bytes) {
+    switch (mode) {
+        case BW_WRITE_STORE:
+        case BW_WRITE_RMW:
+            return 1;
+#ifdef __aarch64__
+        case BW_WRITE_NT:
+            return bw_cacheline_bytes % 16 == 0;
+        case BW_WRITE_DCZVA: {
+            size_t block = dczva_block_bytes();
+            return block && bw_cacheline_bytes % block == 0;
+        }
+#endif
+#ifdef __x86_64__
+        case BW_WRITE_NT:
+            return bw_cacheline_bytes % 8 == 0;
+#endif
+    }
+    return 0;
+}
+
+int bw_write_mode_select(int mode, size_t bw_cacheline_bytes) {
+
+    if (! bw_write_mode_supported(mode, bw_cacheline_bytes)) {
+        printf("ERROR: bandwidth write mode %s is not supported on this CPU with bw_cacheline_bytes = %zu\n",
+                bw_write_mode_map(mode), bw_cacheline_bytes);
+#ifdef __aarch64__
+        if (mode == BW_WRITE_DCZVA && dczva_block_bytes()) {
+            printf("DC ZVA block size is %zu bytes\n", dczva_block_bytes());
+        }
+#endif
+        exit(-1);
+    }
+
+    return mode;
+}
+
+int bw_atomic_op_select(int op) {
+#ifdef __aarch64__
+    if (! (getauxval(AT_HWCAP) & HWCAP_ATOMICS)) {
+        printf("ERROR: --bw-kind atomic needs the LSE atomic instructions, which this CPU does not have\n");
+        exit(-1);
+    }
+#endif
+    return op;
+}
+
+bw_atomic_kernel_t bw_atomic_kernel(int op) {
+    if (op == BW_ATOMIC_CAS) {
+        return cas_atomic;
+    }
+    return add_atomic;
+}
+
+bw_pattern_kernel_t bw_pattern_kernel(int pattern, int bw_write, int bw_write_mode) {
+    switch (pattern) {
+        case BW_PATTERN_RANDOM:
+            return ! bw_write ? random_read : bw_write_mode == BW_WRITE_RMW ? random_update : random_store;
+        case BW_PATTERN_STRIDED:
+            return ! bw_write ? strided_read : bw_write_mode == BW_WRITE_RMW ? strided_update : strided_store;
+    }
+    return NULL;
+}
+
+bw_stream_kernel_t bw_stream_kernel(int kind) {
+    switch (kind) {
+        case BW_KIND_COPY:
+            return copy_stream;
+        case BW_KIND_SCALE:
+            return scale_stream;
+        case BW_KIND_ADD:
+            return add_stream;
+        case BW_KIND_TRIAD:
+            return triad_stream;
+    }
+    return NULL;
+}
+
+void bw_kind_streams(int kind, int * read_streams, int * write_streams) {
+    switch (kind) {
+        case BW_KIND_WRITE:
+            *read_streams = 0;
+            *write_streams = 1;
+            return;
+        case BW_KIND_COPY:
+        case BW_KIND_SCALE:
+            *read_streams = 1;
+            *write_streams = 1;
+            return;
+        case BW_KIND_ADD:
+        case BW_KIND_TRIAD:
+            *read_streams = 2;
+            *write_streams = 1;
+            return;
+    }
+    *read_streams = 1;
+    *write_streams = 0;
+}
+
+bw_kernel_t bw_write_kernel(int mode) {
+    switch (mode) {
+        case BW_WRITE_RMW:
+            return rmw_write;
+        case BW_WRITE_NT:
+            return nt_write;
+#ifdef __aarch64__
+        case BW_WRITE_DCZVA:
+            return dczva_write;
+#endif
+    }
+    return my_write;
+}
@@ -0,0 +1,124 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef BWKERNELS_H
+#define BWKERNELS_H
+
+enum {
+    BW_KERNEL_AUTO,         // widest supported kernel
+    BW_KERNEL_SCALAR,       // one 64-bit load per cache line
+    BW_KERNEL_NEON,         // aarch64 Advanced SIMD, full cache line
+    BW_KERNEL_SVE,          // aarch64 SVE, full cache line
+    BW_KERNEL_AVX2,         // x86_64 AVX2, full cache line
+    BW_KERNEL_AVX512,       // x86_64 AVX-512, full cache line
+    BW_KERNEL_MAX_ENUM
+};
+
+enum {
+    BW_WRITE_STORE,         // one 64-bit store per cache line
+    BW_WRITE_DCZVA,         // aarch64 DC ZVA of each cache line
+    BW_WRITE_NT,            // non-temporal stores of each full cache line
+    BW_WRITE_RMW,           // load, modify and store one 64-bit dword per cache line
+    BW_WRITE_MAX_ENUM
+};
+
+enum {
+    BW_KIND_READ,           // reads of a private buffer with a read kernel
+    BW_KIND_WRITE,          // writes of a private buffer with a write mode
+    BW_KIND_ATOMIC,         // atomic operations on lines shared by all the bandwidth threads
+    BW_KIND_COPY,           // STREAM copy:  c[i] = a[i]
+    BW_KIND_SCALE,          // STREAM scale: c[i] = q * a[i]
+    BW_KIND_ADD,            // STREAM add:   c[i] = a[i] + b[i]
+    BW_KIND_TRIAD,          // STREAM triad: c[i] = a[i] + q * b[i]
+    BW_KIND_MAX_ENUM
+};
+
+enum {
+    BW_ATOMIC_ADD,          // aarch64 LSE LDADD, x86_64 LOCK XADD
+    BW_ATOMIC_CAS,          // compare-and-swap loop: aarch64 LSE CAS, x86_64 LOCK CMPXCHG
+    BW_ATOMIC_MAX_ENUM
+};
+
+enum {
+    BW_PATTERN_SEQUENTIAL,  // each cache line in turn, in the kernels above
+    BW_PATTERN_RANDOM,      // independent uniformly random cache lines
+    BW_PATTERN_STRIDED,     // cache lines a fixed stride apart, wrapping to the next line
+    BW_PATTERN_MAX_ENUM
+};
+
+/* A kernel sweeps [p, p+bytes) one cache line at a time with inner_nops of
+   delay after each line.  If prefetch_bytes is not 0, the address
+   prefetch_bytes ahead is software prefetched before each line is accessed. */
+
+typedef void (*bw_kernel_t)(void * p, size_t bytes, size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes);
+
+// returns 1 if kernel can run on this CPU with this cache line size
+int bw_kernel_supported(int kernel, size_t bw_cacheline_bytes);
+
+// resolves BW_KERNEL_AUTO and exits with an error if the kernel is not supported
+int bw_kernel_select(int kernel, size_t bw_cacheline_bytes);
+
+bw_kernel_t bw_read_kernel(int kernel);
+
+// returns 1 if write mode can run on this CPU with this cache line size
+int bw_write_mode_supported(int mode, size_t bw_cacheline_bytes);
+
+// exits with an error if the write mode is not supported
+int bw_write_mode_select(int mode, size_t bw_cacheline_bytes);
+
+bw_kernel_t bw_write_kernel(int mode);
+
+/* An atomic kernel increments a 64-bit counter in each of ops cache lines,
+   going round the line_count shared lines at lines, with inner_nops of delay
+   after each operation. */
+
+typedef void (*bw_atomic_kernel_t)(void * lines, size_t line_count, size_t ops, size_t inner_nops, size_t bw_cacheline_bytes);
+
+// exits with an error if the atomic operation is not supported
+int bw_atomic_op_select(int op);
+
+bw_atomic_kernel_t bw_atomic_kernel(int op);
+
+/* A stream kernel computes every 64-bit double of [c, c+bytes) from the
+   same doubles of a (and of b for add and triad), one cache line at a time
+   with inner_nops of delay after each line.  If prefetch_bytes is not 0, the
+   lines prefetch_bytes ahead in each array are software prefetched. */
+
+typedef void (*bw_stream_kernel_t)(double * c, const double * a, const double * b, size_t bytes,
+                                   size_t inner_nops, size_t bw_cacheline_bytes, size_t prefetch_bytes);
+
+// NULL unless kind is one of the STREAM kinds
+bw_stream_kernel_t bw_stream_kernel(int kind);
+
+/* A pattern kernel makes accesses to one 64-bit dword of the cache lines of
+   [p, p+buflen) in the order of its --bw-pattern, with inner_nops of delay
+   after each access.  The addresses do not depend on the data loaded, so the
+   accesses can overlap as much as the core allows.  The state carries the
+   pattern from one call to the next. */
+
+struct bw_pattern_state {
+    unsigned long rng;      // BW_PATTERN_RANDOM: xorshift64 state, not 0
+    size_t        stride;   // BW_PATTERN_STRIDED: bytes from one access to the next
+    size_t        offset;   // BW_PATTERN_STRIDED: the next access
+    size_t        column;   // BW_PATTERN_STRIDED: the first access of this pass of the buffer
+};
+
+typedef void (*bw_pattern_kernel_t)(void * p, size_t buflen, size_t accesses, struct bw_pattern_state * state,
+                                    size_t inner_nops, size_t bw_cacheline_bytes);
+
+/* NULL for BW_PATTERN_SEQUENTIAL.  Reads load the dword, and writes store it
+   (BW_WRITE_STORE) or add to it (BW_WRITE_RMW, as a GUPS update). */
+
+bw_pattern_kernel_t bw_pattern_kernel(int pattern, int bw_write, int bw_write_mode);
+
+/* The buffers that each line of an iteration reads and writes, for the byte
+   accounting: a sweep of a bw_buflen buffer moves (read_streams +
+   write_streams) * bw_buflen bytes.  An atomic operation counts as one read
+   of its line. */
+
+void bw_kind_streams(int kind, int * read_streams, int * write_streams);
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef __aarch64__
+#include "cntvct.h"
+#endif
+
+#ifdef __x86_64__
+#include "rdtsc.h"
+#endif
+
+#include "phase.h"
+#include "c2c.h"
+
+#define C2C_STOPPED INT_MAX     // published as the pair when the measurement is over
+
+/* Round trip i hands the line from the initiator to the responder as value
+   2i+1 and back as 2i+2.  The initiator resets the line to 0 before it
+   publishes the next pair. */
+
+static void store_handoff(unsigned long * line, unsigned long wait_for, unsigned long value) {
+    while (__atomic_load_n(line, __ATOMIC_RELAXED) != wait_for) {
+        ;
+    }
+    __atomic_store_n(line, value, __ATOMIC_RELAXED);
+}
+
+static void atomic_handoff(unsigned long * line, unsigned long wait_for, unsigned long value) {
+    unsigned long expected;
+
+    do {
+        expected = wait_for;
+    } while (! __atomic_compare_exchange_n(line, &expected, value, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+}
+
+// the initiator does the first handoff of each round trip, so it only waits for the second
+
+static void initiate(struct c2c_ctl * ctl, unsigned long i) {
+    if (ctl->mode == C2C_MODE_ATOMIC) {
+        atomic_handoff(&ctl->line, 2 * i, 2 * i + 1);
+    } else {
+        __atomic_store_n(&ctl->line, 2 * i + 1, __ATOMIC_RELAXED);
+    }
+
+    while (__atomic_load_n(&ctl->line, __ATOMIC_RELAXED) != 2 * i + 2) {
+        ;
+    }
+}
+
+static void respond(struct c2c_ctl * ctl, unsigned long i) {
+    if (ctl->mode == C2C_MODE_ATOMIC) {
+        atomic_handoff(&ctl->line, 2 * i + 1, 2 * i + 2);
+    } else {
+        store_handoff(&ctl->line, 2 * i + 1, 2 * i + 2);
+    }
+}
+
+// waits for pair p to be published.  Returns 0 if the measurement is over instead.
+
+static int wait_pair(struct c2c_ctl * ctl, int p) {
+    int pair;
+
+    while ((pair = __atomic_load_n(&ctl->pair, __ATOMIC_ACQUIRE)) < p) {
+        ;
+    }
+
+    return pair == p;
+}
+
+void c2c_thread(struct c2c_thread_info * c2c_tinfo) {
+    struct c2c_ctl * ctl            = c2c_tinfo->c2c_ctl;
+    struct start_ctl * start_ctl    = c2c_tinfo->start_ctl;
+    struct stop_ctl * stop_ctl      = c2c_tinfo->stop_ctl;
+    int thread_num                  = c2c_tinfo->thread_num;
+    int cpu                         = c2c_tinfo->cpu;
+    int n                           = ctl->num_threads;
+    size_t round_trips              = C2C_WARMUP_ROUND_TRIPS + ctl->iterations;
+    double cntfreq                  = (double) read_cntfreq();
+
+    printf("CPU%d C2CTHREAD%d: iterations = %zu, tid = %d\n", cpu, thread_num, ctl->iterations, gettid());
+
+    start_ready(start_ctl);
+
+    unsigned long hwcounter_start = start_ctl->hwcounter_start;
+    unsigned long hwcounter_stop  = start_ctl->hwcounter_stop;
+
+    while (read_hwcounter() < hwcounter_start) {
+        ;
+    }
+
+    // pair p is (a, b); a thread leaves once it has no more pairs
+
+    int p = 0;
+
+    for (int a = 0; a < n && a <= thread_num; a++) {
+        for (int b = a + 1; b < n; b++, p++) {
+
+            if (a == thread_num) {
+                if (! wait_pair(ctl, p)) {
+                    return;
+                }
+
+                if (stop_check(stop_ctl, read_hwcounter(), hwcounter_stop)) {
+                    __atomic_store_n(&ctl->pair, C2C_STOPPED, __ATOMIC_RELEASE);
+                    return;
+                }
+
+                unsigned long start_tick = 0;
+
+                for (size_t i = 0; i < round_trips; i++) {
+                    if (i == C2C_WARMUP_ROUND_TRIPS) {
+                        start_tick = read_hwcounter_start();
+                    }
+                    initiate(ctl, i);
+                }
+
+                unsigned long ticks = read_hwcounter_stop() - start_tick;
+                double ns = ticks / cntfreq * 1e9 / ctl->iterations / 2;
+
+                ctl->latency[a * n + b] = ctl->latency[b * n + a] = ns;
+                c2c_tinfo->pairs_measured++;
+
+                __atomic_store_n(&ctl->line, 0, __ATOMIC_RELAXED);
+                __atomic_store_n(&ctl->pair, p + 1, __ATOMIC_RELEASE);
+
+            } else if (b == thread_num) {
+                if (! wait_pair(ctl, p)) {
+                    return;
+                }
+
+                for (size_t i = 0; i < round_trips; i++) {
+                    respond(ctl, i);
+                }
+            }
+        }
+    }
+}
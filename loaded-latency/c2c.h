@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef C2C_H
+#define C2C_H
+
+/*
+ * Core-to-core latency.  --c2c-cpus runs a c2c thread on each CPU of a list.
+ * The pairs of c2c threads take turns, one pair at a time, in the order
+ * (0,1), (0,2), ..., (1,2), ...: the lower-numbered thread of the pair, the
+ * initiator, hands a cache line to the other, the responder, which hands it
+ * back, for C2C_WARMUP_ROUND_TRIPS and then --c2c-iterations timed round
+ * trips.  The one-way latency of a pair is half of the mean round trip.
+ *
+ * The c2c threads start with the latency and bandwidth threads, but do not
+ * take part in their stop_ctl: they stop once every pair is measured, or
+ * before the next pair once the measurement is over, leaving the rest of
+ * the pairs unmeasured.
+ */
+
+#define C2C_WARMUP_ROUND_TRIPS 100
+#define C2C_LINE_BYTES 128          // keeps the adjacent-line prefetcher off the bounced line
+
+enum {
+    C2C_MODE_STORE,         // each side spins loading the line, then stores the next value
+    C2C_MODE_ATOMIC,        // each side spins on a compare-and-swap of the line to the next value
+    C2C_MODE_MAX_ENUM
+};
+
+struct c2c_ctl {
+    int           num_threads;
+    int           mode;             // C2C_MODE_*
+    size_t        iterations;       // timed round trips per pair
+    double *      latency;          // output: num_threads x num_threads one-way ns, 0 if not measured
+    int           pair __attribute__((aligned(C2C_LINE_BYTES)));    // the pair being measured (atomic)
+    unsigned long line __attribute__((aligned(C2C_LINE_BYTES)));    // the bounced cache line (atomic)
+};
+
+struct c2c_thread_info {
+    pthread_t     thread_id;
+    int           thread_num;
+    int           cpu;              // cpu on which this thread is run
+    int           pairs_measured;   // output: pairs this thread initiated
+    int           finished;         // output: set when the thread returns (atomic)
+    struct c2c_ctl * c2c_ctl;       // shared by all c2c threads
+    struct start_ctl * start_ctl;   // shared by all threads to start together
+    struct stop_ctl * stop_ctl;     // polled for the end of the measurement
+    char          threadname[32];
+};
+
+void c2c_thread(struct c2c_thread_info * c2c_tinfo);
+
+#endif
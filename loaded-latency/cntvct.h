@@ -22,6 +22,25 @@ static inline unsigned long read_hwcounter(void) {
     return tick;
 }
 
+/* read_hwcounter_start() and read_hwcounter_stop() bracket a timed interval.
+   The ISB before the counter read waits for the instructions before it, and
+   the ISB after the start read keeps the timed instructions from starting
+   before it. */
+
+static inline unsigned long read_hwcounter_start(void) {
+    unsigned long tick;
+
+    asm volatile("isb" : : : "memory");
+    asm volatile("mrs %0, cntvct_el0" : "=r" (tick) );
+    asm volatile("isb" : : : "memory");
+
+    return tick;
+}
+
+static inline unsigned long read_hwcounter_stop(void) {
+    return read_hwcounter();
+}
+
 static inline unsigned long read_cntfreq(void) {
     extern args_t args;
     return args.hwclock_freq;
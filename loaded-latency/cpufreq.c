@@ -0,0 +1,211 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+
+#ifdef __aarch64__
+#include "cntvct.h"
+#endif
+
+#ifdef __x86_64__
+#include "rdtsc.h"
+#endif
+
+#include "stats.h"
+#include "perf.h"
+#include "cpufreq.h"
+
+/* Each add depends on the one before it, so the loop runs at one add per
+   cycle; the loop counter and branch execute in parallel with the adds.  The
+   adds are of registers, since some cores fold the adds of immediates at
+   rename, without executing them. */
+
+#ifdef __aarch64__
+#define ALU_ADD "add %0, %0, %0\n\t"
+#else
+#define ALU_ADD "add %0, %0\n\t"
+#endif
+
+#define ALU_ADDS_PER_ITERATION 10
+#define ALU_CALIBRATE_ITERATIONS 1000000    // about 3 ms at 3 GHz
+#define ALU_CALIBRATE_RUNS 5
+#define ALU_PROBE_ITERATIONS 10000          // about 30 us at 3 GHz
+
+static const char * cpu_freq_methods[] = {
+    [CPU_FREQ_NONE]  = "none",
+    [CPU_FREQ_PMU]   = "pmu",
+    [CPU_FREQ_SYSFS] = "cpufreq",
+    [CPU_FREQ_ALU]   = "alu",
+};
+
+const char * cpu_freq_method_map(int method) {
+    return cpu_freq_methods[method];
+}
+
+static void alu_loop(size_t iterations) {
+    unsigned long x = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        asm volatile (ALU_ADD ALU_ADD ALU_ADD ALU_ADD ALU_ADD
+                      ALU_ADD ALU_ADD ALU_ADD ALU_ADD ALU_ADD : "+r" (x) : : "cc");
+    }
+}
+
+// returns the ticks taken by the loop
+static unsigned long alu_loop_ticks(size_t iterations) {
+    unsigned long start_tick = read_hwcounter_start();
+    alu_loop(iterations);
+    return read_hwcounter_stop() - start_tick;
+}
+
+static double alu_mhz(size_t iterations, unsigned long ticks) {
+    return iterations * ALU_ADDS_PER_ITERATION / (ticks / (double) read_cntfreq()) / 1e6;
+}
+
+static double read_sysfs_mhz(int fd) {
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    if (n <= 0) {
+        return 0.0;
+    }
+    buf[n] = '\0';
+
+    return strtoul(buf, NULL, 10) / 1e3;      // scaling_cur_freq is in kHz
+}
+
+static int open_sysfs(int cpu) {
+    char path[128];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+    int fd = open(path, O_RDONLY);
+
+    if (fd >= 0 && read_sysfs_mhz(fd) == 0.0) {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+void cpu_freq_open(struct cpu_freq * freq, int cpu, const char * label) {
+    memset(freq, 0, sizeof(*freq));
+    freq->cycles_fd = -1;
+    freq->sysfs_fd = -1;
+
+    if ((freq->cycles_fd = perf_open_cycles()) >= 0) {
+        freq->method = CPU_FREQ_PMU;
+    } else if ((freq->sysfs_fd = open_sysfs(cpu)) >= 0) {
+        freq->method = CPU_FREQ_SYSFS;
+    } else {
+        freq->method = CPU_FREQ_ALU;
+    }
+
+    // the fastest of several runs is the one least disturbed; the first also ramps up the frequency
+
+    double sysfs_mhz = 0.0;
+
+    for (int i = 0; i < ALU_CALIBRATE_RUNS; i++) {
+        cpu_freq_start(freq);
+        unsigned long ticks = alu_loop_ticks(ALU_CALIBRATE_ITERATIONS);
+
+        double mhz = freq->method == CPU_FREQ_PMU ? cpu_freq_stop(freq, ticks) : alu_mhz(ALU_CALIBRATE_ITERATIONS, ticks);
+
+        if (mhz > freq->base_mhz) {
+            freq->base_mhz = mhz;
+            if (freq->method == CPU_FREQ_SYSFS) {
+                sysfs_mhz = (freq->start_mhz + read_sysfs_mhz(freq->sysfs_fd)) / 2;
+            }
+        }
+    }
+
+    if (freq->method == CPU_FREQ_SYSFS) {
+        freq->sysfs_scale = freq->base_mhz / sysfs_mhz;
+        printf("%s: core frequency measured by %s, %.3f MHz before the start, scaling_cur_freq %.3f MHz\n",
+               label, cpu_freq_method_map(freq->method), freq->base_mhz, sysfs_mhz);
+    } else {
+        printf("%s: core frequency measured by %s, %.3f MHz before the start\n",
+               label, cpu_freq_method_map(freq->method), freq->base_mhz);
+    }
+}
+
+void cpu_freq_start(struct cpu_freq * freq) {
+    switch (freq->method) {
+        case CPU_FREQ_PMU:
+            freq->start_cycles = perf_read_cycles(freq->cycles_fd);
+            break;
+        case CPU_FREQ_SYSFS:
+            freq->start_mhz = read_sysfs_mhz(freq->sysfs_fd);
+            break;
+        default:
+            break;
+    }
+}
+
+double cpu_freq_stop(struct cpu_freq * freq, unsigned long ticks) {
+    switch (freq->method) {
+        case CPU_FREQ_PMU:
+            return (perf_read_cycles(freq->cycles_fd) - freq->start_cycles) / (ticks / (double) read_cntfreq()) / 1e6;
+        case CPU_FREQ_SYSFS:
+            return (freq->start_mhz + read_sysfs_mhz(freq->sysfs_fd)) / 2 * freq->sysfs_scale;
+        case CPU_FREQ_ALU:
+            // the frequency just after the interval stands for the frequency during it
+            return alu_mhz(ALU_PROBE_ITERATIONS, alu_loop_ticks(ALU_PROBE_ITERATIONS));
+        default:
+            return 0.0;
+    }
+}
+
+void cpu_freq_close(struct cpu_freq * freq) {
+    if (freq->cycles_fd >= 0) {
+        close(freq->cycles_fd);
+        freq->cycles_fd = -1;
+    }
+    if (freq->sysfs_fd >= 0) {
+        close(freq->sysfs_fd);
+        freq->sysfs_fd = -1;
+    }
+}
+
+void compute_cpu_freq_stats(const struct cpu_freq * freq, const struct sample * samples, size_t count,
+        struct cpu_freq_stats * stats) {
+    double weighted_mhz = 0.0, ticks = 0.0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->min_mhz = INFINITY;
+
+    for (size_t i = 0; i < count; i++) {
+        const struct sample * s = &samples[i];
+
+        if (s->core_mhz == 0.0) {
+            continue;
+        }
+
+        weighted_mhz += s->core_mhz * (s->stop_tick - s->start_tick);
+        ticks += s->stop_tick - s->start_tick;
+        stats->mean_cycles += s->value * s->core_mhz / 1e3;
+        if (s->core_mhz < stats->min_mhz) {
+            stats->min_mhz = s->core_mhz;
+        }
+        if (s->core_mhz < freq->base_mhz * (1 - CPU_FREQ_DROP_FRACTION)) {
+            stats->drops++;
+        }
+        stats->count++;
+    }
+
+    if (stats->count) {
+        stats->mean_mhz = weighted_mhz / ticks;
+        stats->mean_cycles /= stats->count;
+    } else {
+        stats->min_mhz = 0.0;
+    }
+}
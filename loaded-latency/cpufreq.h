@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef CPUFREQ_H
+#define CPUFREQ_H
+
+/*
+ * --measure-cpu-freq measures the core frequency of every interval of a
+ * latency thread instead of assuming the --cpu-freq-mhz value.  The core
+ * cycles are counted by the PMU cycle counter if it can be opened.  Otherwise
+ * the frequency is read from the cpufreq scaling_cur_freq of the CPU at the
+ * start and the end of the interval, scaled by a calibration against a loop
+ * of dependent adds, which take one cycle each.  Without cpufreq, a short run
+ * of the loop after each interval measures the frequency.
+ *
+ * Before the start, the loop measures the frequency of the CPU with no load
+ * from this program, which is base_mhz.  An interval that runs more than
+ * CPU_FREQ_DROP_FRACTION below it is counted as a frequency drop.
+ *
+ * cpufreq.h uses struct sample from stats.h.
+ */
+
+#define CPU_FREQ_DROP_FRACTION 0.05
+
+enum {
+    CPU_FREQ_NONE = 0,          // not measured; cycles are from --cpu-freq-mhz
+    CPU_FREQ_PMU,
+    CPU_FREQ_SYSFS,
+    CPU_FREQ_ALU,
+};
+
+struct cpu_freq {
+    int           method;
+    int           cycles_fd;        // CPU_FREQ_PMU: perf cycle counter of the thread
+    int           sysfs_fd;         // CPU_FREQ_SYSFS: scaling_cur_freq of the CPU
+    double        base_mhz;         // measured before the start
+    double        sysfs_scale;      // CPU_FREQ_SYSFS: base_mhz over scaling_cur_freq at the calibration
+    double        start_mhz;        // CPU_FREQ_SYSFS: scaling_cur_freq at cpu_freq_start()
+    unsigned long start_cycles;     // CPU_FREQ_PMU: cycles at cpu_freq_start()
+};
+
+struct cpu_freq_stats {
+    size_t        count;            // samples with a measured frequency
+    double        mean_mhz;         // weighted by the length of the intervals
+    double        min_mhz;
+    double        mean_cycles;      // mean of the sample values in ns times the frequency of each
+    size_t        drops;            // samples more than CPU_FREQ_DROP_FRACTION below base_mhz
+};
+
+const char * cpu_freq_method_map(int method);
+
+// chooses the method and measures base_mhz on the calling thread, printing both prefixed by label
+void cpu_freq_open(struct cpu_freq * freq, int cpu, const char * label);
+
+// reads the frequency state at the start of an interval
+void cpu_freq_start(struct cpu_freq * freq);
+
+// returns the core frequency in MHz of an interval of ticks HWCOUNTER ticks
+double cpu_freq_stop(struct cpu_freq * freq, unsigned long ticks);
+
+// closes the counter or sysfs file when the thread exits; the method and base_mhz stay for the stats
+void cpu_freq_close(struct cpu_freq * freq);
+
+void compute_cpu_freq_stats(const struct cpu_freq * freq, const struct sample * samples, size_t count,
+        struct cpu_freq_stats * stats);
+
+#endif
@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <sys/prctl.h>
 #include <sys/time.h>
@@ -26,8 +27,15 @@
 
 #include "args.h"
 #include "alloc.h"
+#include "phase.h"
+#include "stats.h"
+#include "perf.h"
+#include "cpufreq.h"
+#include "bwkernels.h"
 #include "bandwidth.h"
 #include "memlatency.h"
+#include "c2c.h"
+#include "output.h"
 
 #define handle_error_en(en, msg) \
         do { errno = en; perror(msg); exit(EXIT_FAILURE); } while (0)
@@ -45,8 +53,38 @@ static void dump_mem(void ** mem, size_t cacheline_count);
 static void thread_set_affinity(int my_cpu_number) __attribute__((noinline));
 static void * bw_thread_start(void *arg);
 static void * lat_thread_start(void *arg);
+static void * c2c_thread_start(void *arg);
 static unsigned long max(unsigned long x, unsigned long y);
 static unsigned long min(unsigned long x, unsigned long y);
+static int mem_node_for_thread(const int * mem_nodes, int mem_node_count, size_t thread_num);
+static void print_mem_nodes(const int * mem_nodes, int mem_node_count);
+static double total_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads);
+static double average_latency(const struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static double concurrent_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads);
+static double concurrent_latency(const struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static int concurrent_window(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads,
+        unsigned long * window_start, unsigned long * window_stop);
+static void apply_concurrent_window(struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static double average_chain_speedup(const struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static void print_thread_stats(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static void print_total_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads);
+static int bw_override_writes(void);
+static void check_thread_overrides(void);
+static void print_thread_overrides(int bw);
+static size_t sweep_phase_count(void);
+static int bw_ramp_threads(size_t phase, int num_bw_threads);
+static void run_sweep(struct phase_ctl * phase_ctl, struct stop_ctl * stop_ctl,
+        struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static void collect_samples(void * arg);
+static void print_c2c_latency(const struct c2c_ctl * c2c_ctl, const struct c2c_thread_info * c2c_tinfo);
+static void print_samples(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads);
+static void report_dropped_samples(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads);
 unsigned long estimate_hwclock_freq(long cpu_num, size_t n, int verbose, struct timeval target_measurement_duration);
 
 
@@ -54,16 +92,15 @@ unsigned long estimate_hwclock_freq(long cpu_num, size_t n, int verbose, struct
 args_t args = {
     .duration = 10,       // how long to run in seconds
     .show_per_thread_concurrency = 0, // default is hide the per-thread concurrency metrics
-    .delay_seconds = 0.,
-    .delay_seconds_valid = 0,   // delay_seconds is not valid
-#ifdef __x86_64__
-    .delay_ticks = 0x30000000,  // TSC ticks
-#else
-    .delay_ticks = 200000,      // HWCOUNTER ticks for thread setup and init
-#endif
+    .perf = 0,            // default do not count PMU events
+    .delay_seconds = PHASE_START_MARGIN_SECONDS,  // margin from the last thread being ready to the start
+    .delay_seconds_valid = 1,   // delay_ticks is computed from delay_seconds
+    .delay_seconds_set = 0,
+    .delay_ticks = 0,
 #define CYCLE_TIME_NS (1e9/2600e6)   // 2600 MHz as the default
     .cycle_time_ns = CYCLE_TIME_NS,
     .mhz = 1e3/CYCLE_TIME_NS,
+    .measure_cpu_freq = 0,       // default compute cycles with mhz
     .hwclock_freq = 0,           // placeholder; if still 0, will use self-determined values
     .estimate_hwclock_freq_cpu = -1, // -1 means don't do the estimation
     .random_seedval = 0,
@@ -81,6 +118,8 @@ args_t args = {
     .lat_shared_memory = 0,      // latency: share memory
     .lat_shared_memory_init_cpu = -1,        // latency: cpu on which shared memory will be initialized; if not set will use lowest numbered CPU of latency threads
     .lat_clear_cache = 0,        // default do not clear cache on latency loop initialization
+    .lat_mem_node_count = 0,     // default do not bind latency memory to a NUMA node
+    .lat_chains = 1,             // default one dependent chain
 
     .bw_buflen = 8192 * 1024,    // 8 MB
     .bw_inner_nops = 0,
@@ -89,7 +128,36 @@ args_t args = {
     .bw_cacheline_bytes = 64,    // cacheline size default is 64 bytes for bandwdith
     .bw_use_hugepages = HUGEPAGES_NONE,      // use hugepages for bandwidth
     .bw_write = 0,
+    .bw_write_mode = BW_WRITE_STORE,
+    .bw_target_mbps = 0,         // default use the fine and coarse delays as given
+    .bw_target_per_thread = 0,
+    .bw_mem_node_count = 0,      // default do not bind bandwidth memory to a NUMA node
+    .bw_kernel = BW_KERNEL_SCALAR,   // default read one dword per cache line
+    .bw_prefetch_lines = 0,      // default no software prefetch
+    .bw_kind = BW_KIND_READ,     // default read a private buffer
+    .bw_atomic_op = BW_ATOMIC_ADD,
+    .bw_atomic_lines = 1,        // default all the atomic operations contend for one line
+    .bw_pattern = BW_PATTERN_SEQUENTIAL,
+    .bw_stride_bytes = 0,
+
+    .sweep_fine_delay_count = 0, // default run a single phase
+    .bw_ramp_step = 0,           // default run all bandwidth threads in every phase
+
+    .output_format = OUTPUT_NONE,
+    .output_file = NULL,         // default only write the results to stdout
+    .live_samples = 0,           // default print the interim samples after the threads finish
+
+    .c2c_mode = C2C_MODE_STORE,  // default hand the cache line over with plain stores
+    .c2c_iterations = 10000,
+};
+
+/* the threads whose sample rings the main thread collects */
 
+struct sample_collector {
+    struct bw_thread_info * bw_tinfo;
+    int num_bw_threads;
+    struct lat_thread_info * lat_tinfo;
+    int num_lat_threads;
 };
 
 
@@ -98,11 +166,14 @@ args_t args = {
 int main(int argc, char *argv[]) {
     struct bw_thread_info *bw_tinfo;
     struct lat_thread_info *lat_tinfo;
+    struct c2c_thread_info *c2c_tinfo;
     int s;
 
     CPU_ZERO(&args.lat_cpuset);
     CPU_ZERO(&args.lat_warmup_cpuset);
     CPU_ZERO(&args.bw_cpuset);
+    CPU_ZERO(&args.c2c_cpuset);
+    CPU_ZERO(&args.lat_init_cpuset);
 
     pthread_attr_t attr;
     void *res;
@@ -150,6 +221,141 @@ int main(int argc, char *argv[]) {
 
     printf("Total of %d latency threads requested\n", num_lat_threads);
 
+    int num_c2c_threads = CPU_COUNT(&args.c2c_cpuset);
+
+    for (i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &args.c2c_cpuset) && (CPU_ISSET(i, &args.lat_cpuset) || CPU_ISSET(i, &args.bw_cpuset))) {
+            printf("Warning: CPU%d was already specified to run a latency or bandwidth thread, so this will double-up a core-to-core thread on the same CPU.\n", i);
+        }
+    }
+
+    if (num_c2c_threads == 1) {
+        printf("ERROR: --c2c-cpus needs at least 2 CPUs to make a pair\n");
+        exit(-1);
+    }
+
+    if (num_c2c_threads && sweep_phase_count()) {
+        printf("ERROR: --c2c-cpus cannot be used with a multi-phase flag\n");
+        exit(-1);
+    }
+
+    if (args.lat_chains < 1 || args.lat_chains > MAX_LAT_CHAINS) {
+        printf("ERROR: --lat-chains must be from 1 to %d\n", MAX_LAT_CHAINS);
+        exit(-1);
+    }
+
+    if (args.output_file && args.output_format == OUTPUT_NONE) {
+        args.output_format = OUTPUT_JSON;
+    }
+
+    if (args.output_format != OUTPUT_NONE && args.output_file == NULL) {
+        printf("ERROR: --output %s needs --output-file\n", output_format_map(args.output_format));
+        exit(-1);
+    }
+
+    if (args.output_format != OUTPUT_NONE && sweep_phase_count()) {
+        printf("ERROR: --output cannot be used with a multi-phase flag because only the last phase would be written\n");
+        exit(-1);
+    }
+
+    if (args.sweep_fine_delay_count && args.bw_target_mbps > 0) {
+        printf("ERROR: --sweep-fine-delay cannot be used with a bandwidth target because the target sets the fine delay\n");
+        exit(-1);
+    }
+
+    if ((args.sweep_fine_delay_count > 0) + (args.lat_size_count > 0) + (args.bw_ramp_step > 0) > 1) {
+        printf("ERROR: only one of --sweep-fine-delay, --lat-sizes and --bw-ramp can be used at a time\n");
+        exit(-1);
+    }
+
+    if (args.bw_ramp_step && num_bw_threads == 0) {
+        printf("ERROR: --bw-ramp needs bandwidth threads\n");
+        exit(-1);
+    }
+
+    if (args.bw_ramp_step && args.bw_target_mbps > 0 && ! args.bw_target_per_thread) {
+        printf("ERROR: --bw-ramp cannot be used with --bw-target-mbps because the total target is split over all the bandwidth threads; use --bw-target-mbps-per-thread\n");
+        exit(-1);
+    }
+
+    if (sweep_phase_count() > MAX_SWEEP_STEPS) {
+        printf("ERROR: --bw-ramp of %zu threads per phase runs more than %d phases\n", args.bw_ramp_step, MAX_SWEEP_STEPS);
+        exit(-1);
+    }
+
+    if (args.lat_size_count && args.lat_shared_memory) {
+        printf("ERROR: --lat-sizes cannot be used with --lat-shared-memory because each latency thread rebuilds its own loop\n");
+        exit(-1);
+    }
+
+    // the first phase of a sweep uses the first fine delay or latency loop size
+
+    if (args.sweep_fine_delay_count) {
+        args.bw_inner_nops = args.sweep_fine_delays[0];
+    }
+
+    if (args.lat_size_count) {
+        for (size_t k = 0; k < args.lat_size_count; k++) {
+            if (args.lat_sizes[k] < args.lat_cacheline_bytes) {
+                printf("ERROR: --lat-sizes size %zu is less than one cacheline of %zu bytes\n", args.lat_sizes[k], args.lat_cacheline_bytes);
+                exit(-1);
+            }
+        }
+        args.lat_cacheline_count = args.lat_sizes[0] / args.lat_cacheline_bytes;
+    }
+
+    // resolve --bw-kernel auto and check that the kernel runs on this CPU
+
+    args.bw_kernel = bw_kernel_select(args.bw_kernel, args.bw_cacheline_bytes);
+
+    if (args.bw_write || bw_override_writes()) {
+        args.bw_write_mode = bw_write_mode_select(args.bw_write_mode, args.bw_cacheline_bytes);
+    }
+
+    if (args.bw_kind == BW_KIND_ATOMIC) {
+        args.bw_atomic_op = bw_atomic_op_select(args.bw_atomic_op);
+
+        if (args.bw_target_mbps > 0) {
+            printf("ERROR: --bw-kind atomic cannot be used with a bandwidth target\n");
+            exit(-1);
+        }
+    }
+
+    if (args.bw_pattern != BW_PATTERN_SEQUENTIAL) {
+        const char * pattern = bw_pattern_map(args.bw_pattern);
+
+        if (args.bw_kind != BW_KIND_READ && args.bw_kind != BW_KIND_WRITE) {
+            printf("ERROR: --bw-pattern %s needs --bw-kind read or write\n", pattern);
+            exit(-1);
+        }
+        if (args.bw_write && args.bw_write_mode != BW_WRITE_STORE && args.bw_write_mode != BW_WRITE_RMW) {
+            printf("ERROR: --bw-pattern %s needs --bw-write-mode store or rmw\n", pattern);
+            exit(-1);
+        }
+        if (args.bw_prefetch_lines) {
+            printf("ERROR: --bw-prefetch-distance only applies to --bw-pattern sequential\n");
+            exit(-1);
+        }
+        if (args.bw_buflen < args.bw_cacheline_bytes) {
+            printf("ERROR: --bw-pattern %s needs bw_buflen to be at least bw_cacheline_bytes = %zu\n",
+                   pattern, args.bw_cacheline_bytes);
+            exit(-1);
+        }
+        if (args.bw_pattern == BW_PATTERN_STRIDED && args.bw_stride_bytes % args.bw_cacheline_bytes != 0) {
+            printf("ERROR: --bw-pattern strided needs the stride to be a multiple of bw_cacheline_bytes = %zu\n",
+                   args.bw_cacheline_bytes);
+            exit(-1);
+        }
+    }
+
+    if (bw_stream_kernel(args.bw_kind) && args.bw_cacheline_bytes % sizeof(double) != 0) {
+        printf("ERROR: --bw-kind %s needs bw_cacheline_bytes to be a multiple of %zu\n",
+               bw_kind_map(args.bw_kind), sizeof(double));
+        exit(-1);
+    }
+
+    check_thread_overrides();
+
     if (args.hwclock_freq == 0) {
         args.hwclock_freq = get_default_cntfreq();
     }
@@ -193,8 +399,12 @@ int main(int argc, char *argv[]) {
     printf("delay_seconds       (-d) = %f seconds (%zu " HWCOUNTER " ticks at cntfreq=%lu)\n",
             args.delay_seconds, args.delay_ticks, read_cntfreq());
     printf("random_seedval      (-S) = %ld\n", args.random_seedval);
-    /* XXX: frequency is NOT auto-detected by this program */
-    printf("cycle_time_ns       (-t) = %.6f ((-f) %.3f MHz)\n", args.cycle_time_ns, args.mhz);
+    /* XXX: frequency is NOT auto-detected by this program, unless --measure-cpu-freq */
+    if (args.measure_cpu_freq) {
+        printf("cycle_time_ns       (-t) = measured by each latency thread (--measure-cpu-freq)\n");
+    } else {
+        printf("cycle_time_ns       (-t) = %.6f ((-f) %.3f MHz)\n", args.cycle_time_ns, args.mhz);
+    }
     printf("ssbs                (-Q) = speculation feature: "
             "requested %s (retval = 0x%x) "
             "status is %s (retval = 0x%x)\n",
@@ -205,28 +415,96 @@ int main(int argc, char *argv[]) {
     printf("bandwidth settings:\n");
     printf("bw_iterations       (-I) = %zu\n", args.bw_iterations);
     printf("bw_buflen           (-L) = %zu (%.3f (1e6) megabytes)\n", args.bw_buflen, args.bw_buflen / 1000000.);
-    printf("fine loop delay     (-F) = %zu\n", args.bw_inner_nops);
+    if (args.sweep_fine_delay_count) {
+        // not "fine loop delay" so that summarize.sh only sees the per-phase values
+        printf("fine loop sweep         = ");
+        for (size_t k = 0; k < args.sweep_fine_delay_count; k++) {
+            printf("%s%zu", k ? "," : "", args.sweep_fine_delays[k]);
+        }
+        printf("\n");
+    } else {
+        printf("fine loop delay     (-F) = %zu\n", args.bw_inner_nops);
+    }
     printf("coarse loop delay   (-C) = %zu\n", args.bw_outer_nops);
+    if (args.bw_ramp_step) {
+        printf("bw_ramp                 = %zu threads per phase\n", args.bw_ramp_step);
+    }
+    if (args.bw_target_mbps > 0) {
+        printf("bw_target_mbps          = %f MB/sec %s\n", args.bw_target_mbps,
+                args.bw_target_per_thread ? "per thread" : "total");
+    }
     printf("bw_cacheline_bytes  (-Z) = %zu\n", args.bw_cacheline_bytes);
     printf("bw_use_hugepages    (-H) = %d (hugepages = %s)\n", args.bw_use_hugepages, hugepage_map(args.bw_use_hugepages));
     printf("bw_write            (-W) = %d\n", args.bw_write);
+    if (args.bw_write) {
+        printf("bw_write_mode           = %s\n", bw_write_mode_map(args.bw_write_mode));
+    }
+    printf("bw_kind                 = %s\n", bw_kind_map(args.bw_kind));
+    if (args.bw_kind == BW_KIND_ATOMIC) {
+        printf("bw_atomic_op            = %s on %zu shared lines\n", bw_atomic_op_map(args.bw_atomic_op), args.bw_atomic_lines);
+    }
+    if (bw_stream_kernel(args.bw_kind)) {
+        int read_streams, write_streams;
+        bw_kind_streams(args.bw_kind, &read_streams, &write_streams);
+        printf("bw_streams              = %d read + %d write arrays of bw_buflen bytes per thread\n", read_streams, write_streams);
+    }
+    if (args.bw_pattern == BW_PATTERN_STRIDED) {
+        printf("bw_pattern              = strided, %zu bytes\n", args.bw_stride_bytes);
+    } else {
+        printf("bw_pattern              = %s\n", bw_pattern_map(args.bw_pattern));
+    }
+    printf("bw_kernel               = %s%s\n", bw_kernel_map(args.bw_kernel),
+           args.bw_kind != BW_KIND_READ || args.bw_pattern != BW_PATTERN_SEQUENTIAL ? " (only used for sequential reads)" : "");
+    printf("bw_prefetch_distance    = %zu lines\n", args.bw_prefetch_lines);
+    printf("bw_mem_node             = ");
+    print_mem_nodes(args.bw_mem_nodes, args.bw_mem_node_count);
+    print_thread_overrides(1);
 
     printf("\n");
     printf("latency settings:\n");
     printf("lat_cacheline_count (-n) = %zu (%.3f (1e6) megabytes)\n", args.lat_cacheline_count, args.lat_cacheline_count * args.lat_cacheline_bytes / 1000000.);
+    if (args.lat_size_count) {
+        printf("lat_sizes               = ");
+        for (size_t k = 0; k < args.lat_size_count; k++) {
+            printf("%s%zu", k ? "," : "", args.lat_sizes[k]);
+        }
+        printf(" bytes\n");
+    }
     printf("lat_iterations      (-i) = %zu\n", args.lat_iterations);
     printf("lat_offset          (-o) = %zu\n", args.lat_offset);
     printf("lat_secondary_delay (-e) = %zu\n", args.lat_secondary_delay);
     printf("lat_randomize       (-r) = %d\n", args.lat_randomize);
     printf("lat_use_hugepages   (-h) = %d (hugepages = %s)\n", args.lat_use_hugepages, hugepage_map(args.lat_use_hugepages));
     printf("lat_shared_memory   (-s) = %d\n", args.lat_shared_memory);
-    printf("lat_shared_memory_init_cpu(-u) = %d\n", args.lat_shared_memory_init_cpu);
+    printf("lat_shared_memory_init_cpu(-u) = %d", args.lat_shared_memory_init_cpu);
+    if (CPU_COUNT(&args.lat_init_cpuset) > 1) {
+        printf(" (and %d more CPUs to build the loop)", CPU_COUNT(&args.lat_init_cpuset) - 1);
+    }
+    printf("\n");
     printf("lat_clear_cache     (-c) = %d\n", args.lat_clear_cache);
     printf("lat_cacheline_stride(-j) = %zu\n", args.lat_cacheline_stride);
     /* XXX: no machine with other than a 64 byte CL is easily available to test it */
     printf("lat_cacheline_bytes (-z) = %zu\n", args.lat_cacheline_bytes);
+    printf("lat_mem_node            = ");
+    print_mem_nodes(args.lat_mem_nodes, args.lat_mem_node_count);
+    printf("lat_chains              = %zu\n", args.lat_chains);
+    print_thread_overrides(0);
     printf("\n");
 
+    if (num_c2c_threads) {
+        printf("core-to-core latency settings:\n");
+        printf("c2c_cpus                = ");
+        for (i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &args.c2c_cpuset)) {
+                printf("%d ", i);
+            }
+        }
+        printf("\n");
+        printf("c2c_mode                = %s\n", c2c_mode_map(args.c2c_mode));
+        printf("c2c_iterations          = %zu round trips per pair\n", args.c2c_iterations);
+        printf("\n");
+    }
+
 
     /* Initialize thread creation attributes */
 
@@ -235,9 +513,44 @@ int main(int argc, char *argv[]) {
         handle_error_en(s, "pthread_attr_init");
 
 
-    unsigned long hwcounter_now = read_hwcounter();
-    unsigned long hwcounter_start = hwcounter_now + args.delay_ticks;
-    unsigned long hwcounter_stop = hwcounter_start + read_cntfreq() * args.duration;
+    /* synchronized start, shared by all threads */
+
+    struct start_ctl start_ctl = {
+        .threads_ready = 0,
+        .published = 0,
+    };
+
+    /* multi-phase control, shared by all threads */
+
+    struct phase_ctl phase_ctl = {
+        .phase = 0,
+        .done = 0,
+        .bw_inner_nops = args.bw_inner_nops,
+        .bw_active_threads = bw_ramp_threads(0, num_bw_threads),
+        .threads_finished = 0,
+    };
+
+    struct phase_ctl * thread_phase_ctl = sweep_phase_count() ? &phase_ctl : NULL;
+
+    /* synchronized stop, shared by all threads */
+
+    struct stop_ctl stop_ctl = {
+        .stop = 0,
+        .num_threads = bw_ramp_threads(0, num_bw_threads) + num_lat_threads,
+        .threads_stopped = 0,
+    };
+
+
+    /* --bw-kind atomic: the cache lines that all of the bandwidth threads share */
+
+    void * atomic_lines = NULL;
+
+    if (args.bw_kind == BW_KIND_ATOMIC && num_bw_threads > 0) {
+        size_t atomic_bytes = args.bw_atomic_lines * args.bw_cacheline_bytes;
+        atomic_lines = do_alloc(atomic_bytes, 0, sysconf(_SC_PAGESIZE),
+                mem_node_for_thread(args.bw_mem_nodes, args.bw_mem_node_count, 0));
+        report_mem_nodes("bandwidth atomic lines", atomic_lines, atomic_bytes);
+    }
 
 
     /* set up bandwidth threads */
@@ -250,17 +563,37 @@ int main(int argc, char *argv[]) {
 
     for (i = 0; i < CPU_SETSIZE; i++) {
         if (CPU_ISSET(i, &args.bw_cpuset)) {
-            bw_tinfo[bw_thread_num].hwcounter_start = hwcounter_start;
-            bw_tinfo[bw_thread_num].hwcounter_stop = hwcounter_stop;
+            // a -B cpu:override... setting replaces the global one for this thread
+            const struct bw_override * ov = &args.bw_overrides[i];
+            int kind = ov->set && ov->bw_kind >= 0 ? ov->bw_kind : args.bw_kind;
+
             bw_tinfo[bw_thread_num].thread_num = bw_thread_num;
             bw_tinfo[bw_thread_num].cpu = i;
-            bw_tinfo[bw_thread_num].bw_buflen = args.bw_buflen;
-            bw_tinfo[bw_thread_num].inner_nops = args.bw_inner_nops;
-            bw_tinfo[bw_thread_num].outer_nops = args.bw_outer_nops;
-            bw_tinfo[bw_thread_num].iterations = args.bw_iterations;
+            bw_tinfo[bw_thread_num].bw_buflen = ov->set && ov->bw_buflen ? ov->bw_buflen : args.bw_buflen;
+            bw_tinfo[bw_thread_num].inner_nops = ov->set && ov->bw_inner_nops >= 0 ? (size_t) ov->bw_inner_nops : args.bw_inner_nops;
+            bw_tinfo[bw_thread_num].outer_nops = ov->set && ov->bw_outer_nops >= 0 ? (size_t) ov->bw_outer_nops : args.bw_outer_nops;
+            bw_tinfo[bw_thread_num].iterations = ov->set && ov->bw_iterations ? ov->bw_iterations : args.bw_iterations;
             bw_tinfo[bw_thread_num].bw_cacheline_bytes = args.bw_cacheline_bytes;
             bw_tinfo[bw_thread_num].bw_use_hugepages = args.bw_use_hugepages;
-            bw_tinfo[bw_thread_num].bw_write = args.bw_write;
+            bw_tinfo[bw_thread_num].bw_write = kind == BW_KIND_WRITE;
+            bw_tinfo[bw_thread_num].bw_write_mode = args.bw_write_mode;
+            bw_tinfo[bw_thread_num].bw_kernel = args.bw_kernel;
+            bw_tinfo[bw_thread_num].bw_kind = kind;
+            bw_kind_streams(kind, &bw_tinfo[bw_thread_num].read_streams, &bw_tinfo[bw_thread_num].write_streams);
+            bw_tinfo[bw_thread_num].bw_pattern = args.bw_pattern;
+            bw_tinfo[bw_thread_num].bw_stride_bytes = args.bw_stride_bytes;
+            bw_tinfo[bw_thread_num].random_seed = args.random_seedval;
+            bw_tinfo[bw_thread_num].atomic_op = args.bw_atomic_op;
+            bw_tinfo[bw_thread_num].atomic_lines = atomic_lines;
+            bw_tinfo[bw_thread_num].atomic_line_count = args.bw_atomic_lines;
+            bw_tinfo[bw_thread_num].prefetch_bytes = args.bw_prefetch_lines * args.bw_cacheline_bytes;
+            bw_tinfo[bw_thread_num].target_bw = args.bw_target_mbps * 1e6 / (args.bw_target_per_thread ? 1 : num_bw_threads);
+            bw_tinfo[bw_thread_num].mem_node = mem_node_for_thread(args.bw_mem_nodes, args.bw_mem_node_count, bw_thread_num);
+            bw_tinfo[bw_thread_num].phase_ctl = thread_phase_ctl;
+            bw_tinfo[bw_thread_num].start_ctl = &start_ctl;
+            bw_tinfo[bw_thread_num].perf = args.perf;
+            bw_tinfo[bw_thread_num].stop_ctl = &stop_ctl;
+            sample_ring_init(&bw_tinfo[bw_thread_num].ring);
             sprintf(bw_tinfo[bw_thread_num].threadname, "bw_thread_%zu", bw_thread_num);
             bw_thread_num++;
         }
@@ -298,10 +631,12 @@ int main(int argc, char *argv[]) {
 
         int latency_thread_to_setup_memory = args.lat_shared_memory_init_cpu;
 
-        // if -u is not specified to select the CPU on which to init the
-        // shared memory loop, find the lowest CPU of a latency thread.
+        // if -u is not specified to select the CPUs on which to init the
+        // shared memory loop, use the CPUs of the latency threads, and
+        // allocate the memory from the lowest of them.
 
         if (latency_thread_to_setup_memory == -1) {
+            args.lat_init_cpuset = args.lat_cpuset;
             for (i = 0; i < CPU_SETSIZE; i++) {
                 if (CPU_ISSET(i, &args.lat_cpuset)) {
                     latency_thread_to_setup_memory = i;
@@ -310,7 +645,8 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        printf("latency_thread_to_setup_memory = %d\n", latency_thread_to_setup_memory);
+        printf("latency_thread_to_setup_memory = %d, with %d CPUs to build the loop\n",
+                latency_thread_to_setup_memory, CPU_COUNT(&args.lat_init_cpuset));
 
         // set affinity for the threads that set up the shared memory latency loop
 
@@ -330,8 +666,20 @@ int main(int argc, char *argv[]) {
             handle_error("sched_setaffinity");
         }
 
+        int mem_node = mem_node_for_thread(args.lat_mem_nodes, args.lat_mem_node_count, 0);
+
+        struct timeval init_t0, init_t1, init_tdiff;
+        gettimeofday(&init_t0, NULL);
+
         mem = lat_initialize(args.lat_cacheline_bytes, args.lat_cacheline_count, args.lat_randomize,
-                args.lat_clear_cache, args.lat_cacheline_stride, args.lat_use_hugepages);
+                args.lat_clear_cache, args.lat_cacheline_stride, args.lat_use_hugepages, mem_node, args.lat_chains,
+                &args.lat_init_cpuset, args.random_seedval, 0);
+
+        gettimeofday(&init_t1, NULL);
+        timersub(&init_t1, &init_t0, &init_tdiff);
+        printf("latency shared memory initialized in %ld.%06ld seconds\n", init_tdiff.tv_sec, init_tdiff.tv_usec);
+
+        report_mem_nodes("latency shared memory", mem, args.lat_cacheline_bytes * args.lat_cacheline_count);
 
         // restore affinity of main thread
         if (0 != sched_setaffinity(0, sizeof(cpu_set_t), &main_thread_cpu_mask)) {
@@ -349,8 +697,7 @@ int main(int argc, char *argv[]) {
 
     for (i = 0; i < CPU_SETSIZE; i++) {
         if (CPU_ISSET(i, &args.lat_cpuset)) {
-            lat_tinfo[lat_thread_num].hwcounter_start = hwcounter_start + (lat_thread_num > 0 ? args.lat_secondary_delay : 0);
-            lat_tinfo[lat_thread_num].hwcounter_stop = hwcounter_stop + (lat_thread_num > 0 ? args.lat_secondary_delay : 0);
+            lat_tinfo[lat_thread_num].start_delay = lat_thread_num > 0 ? args.lat_secondary_delay : 0;
             lat_tinfo[lat_thread_num].thread_num = lat_thread_num;
             lat_tinfo[lat_thread_num].cpu = i;
             if (CPU_ISSET(i, &args.lat_warmup_cpuset)) {
@@ -358,15 +705,29 @@ int main(int argc, char *argv[]) {
             } else {
                 lat_tinfo[lat_thread_num].warmup = 0;
             }
-            lat_tinfo[lat_thread_num].cacheline_stride = args.lat_cacheline_stride;
+            // an -l cpu:override... setting replaces the global one for this thread
+            const struct lat_override * ov = &args.lat_overrides[i];
+
+            lat_tinfo[lat_thread_num].cacheline_stride = ov->set && ov->lat_cacheline_stride ? ov->lat_cacheline_stride : args.lat_cacheline_stride;
             lat_tinfo[lat_thread_num].randomize = args.lat_randomize;
+            lat_tinfo[lat_thread_num].random_seed = args.random_seedval;
             lat_tinfo[lat_thread_num].use_hugepages = args.lat_use_hugepages;
+            lat_tinfo[lat_thread_num].mem_node = mem_node_for_thread(args.lat_mem_nodes, args.lat_mem_node_count, lat_thread_num);
             lat_tinfo[lat_thread_num].lat_cacheline_bytes = args.lat_cacheline_bytes;
-            lat_tinfo[lat_thread_num].cacheline_count = args.lat_cacheline_count;
+            lat_tinfo[lat_thread_num].cacheline_count = ov->set && ov->lat_cacheline_count ? ov->lat_cacheline_count : args.lat_cacheline_count;
+            lat_tinfo[lat_thread_num].lat_sizes = args.lat_size_count ? args.lat_sizes : NULL;
+            lat_tinfo[lat_thread_num].lat_size_count = args.lat_size_count;
             lat_tinfo[lat_thread_num].iterations = args.lat_iterations;
+            lat_tinfo[lat_thread_num].chains = args.lat_chains;
             lat_tinfo[lat_thread_num].cycle_time_ns = args.cycle_time_ns;
+            lat_tinfo[lat_thread_num].measure_cpu_freq = args.measure_cpu_freq;
             lat_tinfo[lat_thread_num].mem = mem;
             lat_tinfo[lat_thread_num].lat_clear_cache = args.lat_clear_cache;
+            lat_tinfo[lat_thread_num].phase_ctl = thread_phase_ctl;
+            lat_tinfo[lat_thread_num].start_ctl = &start_ctl;
+            lat_tinfo[lat_thread_num].perf = args.perf;
+            lat_tinfo[lat_thread_num].stop_ctl = &stop_ctl;
+            sample_ring_init(&lat_tinfo[lat_thread_num].ring);
             if (lat_thread_num > 0) {
                 lat_tinfo[lat_thread_num].lat_offset = args.lat_offset;
             } else {
@@ -377,6 +738,37 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* set up core-to-core latency threads */
+
+    c2c_tinfo = calloc(num_c2c_threads, sizeof(struct c2c_thread_info));
+    if (c2c_tinfo == NULL)
+        handle_error("calloc");
+
+    struct c2c_ctl c2c_ctl = {
+        .num_threads = num_c2c_threads,
+        .mode = args.c2c_mode,
+        .iterations = args.c2c_iterations,
+        .latency = calloc(num_c2c_threads * num_c2c_threads, sizeof(double)),
+        .pair = 0,
+        .line = 0,
+    };
+    if (c2c_ctl.latency == NULL)
+        handle_error("calloc");
+
+    size_t c2c_thread_num = 0;
+
+    for (i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &args.c2c_cpuset)) {
+            c2c_tinfo[c2c_thread_num].thread_num = c2c_thread_num;
+            c2c_tinfo[c2c_thread_num].cpu = i;
+            c2c_tinfo[c2c_thread_num].c2c_ctl = &c2c_ctl;
+            c2c_tinfo[c2c_thread_num].start_ctl = &start_ctl;
+            c2c_tinfo[c2c_thread_num].stop_ctl = &stop_ctl;
+            sprintf(c2c_tinfo[c2c_thread_num].threadname, "c2c_thread_%zu", c2c_thread_num);
+            c2c_thread_num++;
+        }
+    }
+
     /* start all threads */
 
     // start latency threads first because initialization can take a while
@@ -400,38 +792,134 @@ int main(int argc, char *argv[]) {
             handle_error_en(s, "pthread_create");
     }
 
+    for (i = 0; i < num_c2c_threads; i++) {
+        s = pthread_create(&c2c_tinfo[i].thread_id, &attr,
+                &c2c_thread_start, &c2c_tinfo[i]);
+
+        pthread_setname_np(c2c_tinfo[i].thread_id, &(c2c_tinfo[i].threadname[0]));
+
+        if (s != 0)
+            handle_error_en(s, "pthread_create");
+    }
+
+    /*
+     * Start the threads together once all of them have finished their setup,
+     * which for a latency thread includes building its loop, so the start
+     * can never be missed.  The --delay-seconds margin covers the time for
+     * every thread to see the published start.
+     */
+
+    struct timeval ready_t0, ready_t1, ready_tdiff;
+    gettimeofday(&ready_t0, NULL);
+
+    start_wait_ready(&start_ctl, num_bw_threads + num_lat_threads + num_c2c_threads);
+
+    gettimeofday(&ready_t1, NULL);
+    timersub(&ready_t1, &ready_t0, &ready_tdiff);
+    printf("all threads ready in %ld.%06ld seconds\n", ready_tdiff.tv_sec, ready_tdiff.tv_usec);
+
+    unsigned long hwcounter_start = read_hwcounter() + args.delay_ticks;
+    unsigned long hwcounter_stop = hwcounter_start + read_cntfreq() * args.duration;
+
+    phase_ctl.hwcounter_start = hwcounter_start;
+    phase_ctl.hwcounter_stop = hwcounter_stop;
+
+    start_publish(&start_ctl, hwcounter_start, hwcounter_stop);
+
+
+    /* run the remaining phases of a sweep */
+
+    struct sample_collector collector = { bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads };
+
+    if (sweep_phase_count()) {
+        run_sweep(&phase_ctl, &stop_ctl, bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+    }
+
+    /*
+     * The threads pass their interim samples to the main thread through
+     * sample rings, so they do not printf in the measured loop.  Collect the
+     * samples until every thread has finished.  The main thread is not
+     * pinned, so sleep between collections to stay out of the way.
+     */
+
+    const struct timespec collect_interval = { .tv_sec = 0, .tv_nsec = 1000000 };
+    int running;
+
+    do {
+        collect_samples(&collector);
+        nanosleep(&collect_interval, NULL);
+
+        running = 0;
+        for (i = 0; i < num_bw_threads; i++) {
+            running += ! __atomic_load_n(&bw_tinfo[i].finished, __ATOMIC_ACQUIRE);
+        }
+        for (i = 0; i < num_lat_threads; i++) {
+            running += ! __atomic_load_n(&lat_tinfo[i].finished, __ATOMIC_ACQUIRE);
+        }
+        for (i = 0; i < num_c2c_threads; i++) {
+            running += ! __atomic_load_n(&c2c_tinfo[i].finished, __ATOMIC_ACQUIRE);
+        }
+    } while (running);
+
+    collect_samples(&collector);
+
+    // a sweep has already printed the samples of every phase
+    if (! args.live_samples && ! sweep_phase_count()) {
+        print_samples(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+    }
+
+    report_dropped_samples(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
 
     /* stop all threads */
 
-    double total_bandwidth = 0.0;
     for (i = 0; i < num_bw_threads; i++) {
         s = pthread_join(bw_tinfo[i].thread_id, &res);
         if (s != 0)
             handle_error_en(s, "pthread_join");
 
-        total_bandwidth += bw_tinfo[i].avg_bw;
-
         printf("Joined BWTHREAD%d, avg_bw = %f MB/sec\n", bw_tinfo[i].thread_num, bw_tinfo[i].avg_bw / 1e6);
     }
 
-    double average_latency = 0.0;
-    unsigned long latency_count = 0;
-
     for (i = 0; i < num_lat_threads; i++) {
         s = pthread_join(lat_tinfo[i].thread_id, &res);
         if (s != 0)
             handle_error_en(s, "pthread_join");
 
         printf("Joined LATTHREAD%d, avg_latency = %f ns\n", lat_tinfo[i].thread_num, lat_tinfo[i].avg_latency);
-        average_latency += lat_tinfo[i].avg_latency;
-        latency_count++;
+        if (args.lat_chains > 1) {
+            printf("Joined LATTHREAD%d, avg_chain_speedup = %fx one chain\n", lat_tinfo[i].thread_num, lat_tinfo[i].avg_chain_speedup);
+        }
     }
 
-    average_latency /= latency_count;
+    for (i = 0; i < num_c2c_threads; i++) {
+        s = pthread_join(c2c_tinfo[i].thread_id, &res);
+        if (s != 0)
+            handle_error_en(s, "pthread_join");
+
+        printf("Joined C2CTHREAD%d, pairs_measured = %d\n", c2c_tinfo[i].thread_num, c2c_tinfo[i].pairs_measured);
+    }
 
     printf("\n");
-    printf("Total Bandwidth = %.6f MB/sec\n", total_bandwidth / 1e6);
-    printf("Average Latency = %.6f ns\n\n", average_latency);
+
+    if (num_c2c_threads) {
+        print_c2c_latency(&c2c_ctl, c2c_tinfo);
+    }
+
+    print_thread_stats(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+
+    // a sweep has already printed the totals of every phase, including the last one
+
+    if (! sweep_phase_count()) {
+        apply_concurrent_window(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+
+        print_total_bandwidth(bw_tinfo, num_bw_threads);
+        printf("Average Latency = %.6f ns\n\n", concurrent_latency(lat_tinfo, num_lat_threads));
+        printf("Unwindowed Bandwidth = %.6f MB/sec\n", total_bandwidth(bw_tinfo, num_bw_threads) / 1e6);
+        printf("Unwindowed Latency = %.6f ns\n\n", average_latency(lat_tinfo, num_lat_threads));
+        if (args.lat_chains > 1) {
+            printf("Average Chain Speedup = %.3fx one unloaded chain per latency thread\n\n", average_chain_speedup(lat_tinfo, num_lat_threads));
+        }
+    }
 
 
     /* compute overhang between latency and bandwidth threads */
@@ -615,6 +1103,30 @@ int main(int argc, char *argv[]) {
         printf("bw_lat_stop_spread_ticks  = %ld (%f seconds)\n\n", bw_lat_stop_spread_ticks, bw_lat_stop_spread_seconds);
     }
 
+    if (args.output_format != OUTPUT_NONE) {
+        unsigned long window_start, window_stop;
+
+        if (! concurrent_window(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads, &window_start, &window_stop)) {
+            window_start = window_stop = 0;
+        }
+
+        struct concurrency_metrics metrics = {
+            .bw_hwcounter_start_min  = bw_hwcounter_start_min,
+            .bw_hwcounter_start_max  = bw_hwcounter_start_max,
+            .bw_hwcounter_stop_min   = bw_hwcounter_stop_min,
+            .bw_hwcounter_stop_max   = bw_hwcounter_stop_max,
+            .lat_hwcounter_start_min = lat_hwcounter_start_min,
+            .lat_hwcounter_start_max = lat_hwcounter_start_max,
+            .lat_hwcounter_stop_min  = lat_hwcounter_stop_min,
+            .lat_hwcounter_stop_max  = lat_hwcounter_stop_max,
+            .window_start            = window_start,
+            .window_stop             = window_stop,
+        };
+
+        write_results(&args, hwcounter_start, bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads,
+                num_c2c_threads ? &c2c_ctl : NULL, c2c_tinfo, &metrics);
+    }
+
     s = pthread_attr_destroy(&attr);
     if (s != 0)
         handle_error_en(s, "pthread_attr_destroy");
@@ -691,6 +1203,8 @@ static void * bw_thread_start(void *arg) {
 
     bandwidth_thread(bw_tinfo);
 
+    __atomic_store_n(&bw_tinfo->finished, 1, __ATOMIC_RELEASE);
+
     return bw_tinfo;
 }
 
@@ -701,9 +1215,23 @@ static void * lat_thread_start(void *arg) {
 
     latency_thread(lat_tinfo);
 
+    __atomic_store_n(&lat_tinfo->finished, 1, __ATOMIC_RELEASE);
+
     return lat_tinfo;
 }
 
+static void * c2c_thread_start(void *arg) {
+    struct c2c_thread_info *c2c_tinfo = arg;
+
+    thread_set_affinity(c2c_tinfo->cpu);
+
+    c2c_thread(c2c_tinfo);
+
+    __atomic_store_n(&c2c_tinfo->finished, 1, __ATOMIC_RELEASE);
+
+    return c2c_tinfo;
+}
+
 static unsigned long max(unsigned long x, unsigned long y) {
     if (x > y) {
         return x;
@@ -718,6 +1246,723 @@ static unsigned long min(unsigned long x, unsigned long y) {
     return y;
 }
 
+static double total_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads) {
+    double total = 0.0;
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        total += bw_tinfo[i].avg_bw;
+    }
+
+    return total;
+}
+
+static double average_latency(const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+    double average = 0.0;
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        average += lat_tinfo[i].avg_latency;
+    }
+
+    return average / num_lat_threads;
+}
+
+static double average_chain_speedup(const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+    double average = 0.0;
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        average += lat_tinfo[i].avg_chain_speedup;
+    }
+
+    return average / num_lat_threads;
+}
+
+static double concurrent_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads) {
+    double total = 0.0;
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        total += bw_tinfo[i].window.mean;
+    }
+
+    return total;
+}
+
+static double concurrent_latency(const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+    double average = 0.0;
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        average += lat_tinfo[i].window.mean;
+    }
+
+    return average / num_lat_threads;
+}
+
+/*
+ * concurrent_window() finds the window in which every thread was measuring,
+ * from the latest actual start to the earliest actual stop.  It returns 0 if
+ * the threads did not overlap at all.
+ */
+
+static int concurrent_window(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads,
+        unsigned long * window_start, unsigned long * window_stop) {
+
+    unsigned long start = 0;
+    unsigned long stop = -1;
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        start = max(bw_tinfo[i].actual_hwcounter_start, start);
+        stop  = min(bw_tinfo[i].actual_hwcounter_stop, stop);
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        start = max(lat_tinfo[i].actual_hwcounter_start, start);
+        stop  = min(lat_tinfo[i].actual_hwcounter_stop, stop);
+    }
+
+    *window_start = start;
+    *window_stop = stop;
+
+    return stop > start;
+}
+
+/*
+ * apply_concurrent_window() averages the samples of each thread that lie
+ * entirely within the concurrent window, so that samples taken while other
+ * threads had not yet started or had already stopped, and so ran with less
+ * contention, are not counted.  It prints how much of each thread was
+ * discarded.  A thread with no samples in the window, e.g. because one
+ * sample spans all of it, keeps the average of all of its samples.
+ */
+
+static void apply_concurrent_window(struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+
+    double cntfreq = (double) read_cntfreq();
+    unsigned long window_start, window_stop;
+
+    if (! concurrent_window(bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads, &window_start, &window_stop)) {
+        printf("WARNING: the threads did not run concurrently; averaging all samples\n");
+        window_start = 0;
+        window_stop = -1;
+    } else {
+        printf("concurrent window = %f seconds, from 0x%lx to 0x%lx\n",
+               (window_stop - window_start) / cntfreq, window_start, window_stop);
+    }
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        struct window_stats * w = &bw_tinfo[i].window;
+
+        compute_window_stats(bw_tinfo[i].samples.samples, bw_tinfo[i].samples.count, window_start, window_stop, w);
+        printf("BWTHREAD%d: %zu of %zu samples in the concurrent window, %f seconds discarded\n",
+               bw_tinfo[i].thread_num, w->kept, w->kept + w->discarded, w->discarded_ticks / cntfreq);
+
+        if (w->kept == 0) {
+            printf("WARNING: BWTHREAD%d has no samples in the concurrent window; using all samples.  Decrease --bw-iterations.\n",
+                   bw_tinfo[i].thread_num);
+            w->mean = bw_tinfo[i].avg_bw;
+        }
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        struct window_stats * w = &lat_tinfo[i].window;
+
+        compute_window_stats(lat_tinfo[i].samples.samples, lat_tinfo[i].samples.count, window_start, window_stop, w);
+        printf("LATTHREAD%d: %zu of %zu samples in the concurrent window, %f seconds discarded\n",
+               lat_tinfo[i].thread_num, w->kept, w->kept + w->discarded, w->discarded_ticks / cntfreq);
+
+        if (w->kept == 0) {
+            printf("WARNING: LATTHREAD%d has no samples in the concurrent window; using all samples.  Decrease --lat-iterations.\n",
+                   lat_tinfo[i].thread_num);
+            w->mean = lat_tinfo[i].avg_latency;
+        }
+    }
+
+    printf("\n");
+}
+
+/*
+ * print_perf_totals() prints the --perf event counts of all the samples of a
+ * thread, and each divided by the work of the thread: cache lines for a
+ * bandwidth thread and loads for a latency thread.
+ */
+
+static void print_perf_totals(const char * label, const struct perf_group * group, const struct sample_buf * buf,
+        double work, const char * per) {
+
+    unsigned long totals[SAMPLE_MAX_COUNTERS] = { 0 };
+
+    if (group->count == 0) {
+        return;
+    }
+
+    for (size_t j = 0; j < buf->count; j++) {
+        for (int k = 0; k < group->count; k++) {
+            totals[k] += buf->samples[j].counts[k];
+        }
+    }
+
+    printf("%s %s events:", label, group->software ? "software" : "PMU");
+    for (int k = 0; k < group->count; k++) {
+        printf("%s %s = %lu (%.3f per %s)", k ? "," : "", group->names[k], totals[k], totals[k] / work, per);
+    }
+    printf("\n");
+}
+
+/*
+ * print_cpu_freq_stats() prints the --measure-cpu-freq frequency of a latency
+ * thread and its mean latency in measured cycles, and warns if the frequency
+ * dropped below the frequency before the start in any interval, e.g. because
+ * of the power drawn by the bandwidth threads.
+ */
+
+static void print_cpu_freq_stats(const struct lat_thread_info * lat_tinfo) {
+    struct cpu_freq_stats stats;
+    const struct cpu_freq * freq = &lat_tinfo->cpu_freq;
+
+    compute_cpu_freq_stats(freq, lat_tinfo->samples.samples, lat_tinfo->samples.count, &stats);
+
+    printf("LATTHREAD%d core frequency (%s): %.3f MHz before the start, %.3f MHz mean, %.3f MHz min, latency %.3f cycles mean\n",
+           lat_tinfo->thread_num, cpu_freq_method_map(freq->method), freq->base_mhz,
+           stats.mean_mhz, stats.min_mhz, stats.mean_cycles);
+
+    if (stats.drops) {
+        printf("WARNING: LATTHREAD%d core frequency was more than %.0f%% below %.3f MHz in %zu of %zu intervals, down to %.3f MHz\n",
+               lat_tinfo->thread_num, CPU_FREQ_DROP_FRACTION * 100, freq->base_mhz,
+               stats.drops, stats.count, stats.min_mhz);
+    }
+}
+
+/* prints the concurrent bandwidth of the bandwidth threads, with its atomic
+   or access rate, or its read/write split if there are both read and write
+   streams, which each thread splits by its own --bw-kind */
+
+static void print_total_bandwidth(const struct bw_thread_info * bw_tinfo, int num_bw_threads) {
+    double bandwidth = 0.0, read_bandwidth = 0.0, write_bandwidth = 0.0;
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        int streams = bw_tinfo[i].read_streams + bw_tinfo[i].write_streams;
+
+        bandwidth += bw_tinfo[i].window.mean;
+        read_bandwidth += bw_tinfo[i].window.mean * bw_tinfo[i].read_streams / streams;
+        write_bandwidth += bw_tinfo[i].window.mean * bw_tinfo[i].write_streams / streams;
+    }
+
+    printf("Total Bandwidth = %.6f MB/sec\n", bandwidth / 1e6);
+    if (args.bw_kind == BW_KIND_ATOMIC) {
+        printf("Total Atomic Rate = %.6f Mops/sec\n", bandwidth / args.bw_cacheline_bytes / 1e6);
+    } else if (args.bw_pattern != BW_PATTERN_SEQUENTIAL) {
+        int updates = bw_pattern_updates(bw_tinfo, num_bw_threads);
+        printf("Total %s Rate = %.6f M%s/sec\n", updates ? "Update" : "Access",
+               bandwidth / args.bw_cacheline_bytes / 1e6, updates ? "updates" : "accesses");
+    } else if (read_bandwidth > 0 && write_bandwidth > 0) {
+        printf("Total Read Bandwidth = %.6f MB/sec\n", read_bandwidth / 1e6);
+        printf("Total Write Bandwidth = %.6f MB/sec\n", write_bandwidth / 1e6);
+    }
+}
+
+// returns 1 if a -B override makes a bandwidth thread write, so that the write mode is resolved for it
+
+static int bw_override_writes(void) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (args.bw_overrides[cpu].set && CPU_ISSET(cpu, &args.bw_cpuset) &&
+            args.bw_overrides[cpu].bw_kind == BW_KIND_WRITE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// exits with an error if a -B or -l override does not work with the global settings
+
+static void check_thread_overrides(void) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        const struct bw_override * bw = &args.bw_overrides[cpu];
+        const struct lat_override * lat = &args.lat_overrides[cpu];
+
+        if (bw->set && CPU_ISSET(cpu, &args.bw_cpuset)) {
+            int kind = bw->bw_kind >= 0 ? bw->bw_kind : args.bw_kind;
+            size_t buflen = bw->bw_buflen ? bw->bw_buflen : args.bw_buflen;
+
+            if (bw->bw_kind >= 0 && args.bw_kind == BW_KIND_ATOMIC) {
+                printf("ERROR: -B %d: a per-thread kind cannot be mixed with --bw-kind atomic\n", cpu);
+                exit(-1);
+            }
+            if (bw->bw_inner_nops >= 0 && args.sweep_fine_delay_count) {
+                printf("ERROR: -B %d: F= cannot be used with --sweep-fine-delay\n", cpu);
+                exit(-1);
+            }
+            if (bw->bw_inner_nops >= 0 && args.bw_target_mbps > 0) {
+                printf("ERROR: -B %d: F= cannot be used with a bandwidth target because the target sets the fine delay\n", cpu);
+                exit(-1);
+            }
+            if (args.bw_pattern != BW_PATTERN_SEQUENTIAL &&
+                ((kind != BW_KIND_READ && kind != BW_KIND_WRITE) || buflen < args.bw_cacheline_bytes ||
+                 (kind == BW_KIND_WRITE && args.bw_write_mode != BW_WRITE_STORE && args.bw_write_mode != BW_WRITE_RMW))) {
+                printf("ERROR: -B %d: --bw-pattern %s needs read or write (with --bw-write-mode store or rmw) "
+                       "of at least bw_cacheline_bytes\n", cpu, bw_pattern_map(args.bw_pattern));
+                exit(-1);
+            }
+            if (bw_stream_kernel(kind) && args.bw_cacheline_bytes % sizeof(double) != 0) {
+                printf("ERROR: -B %d: %s needs bw_cacheline_bytes to be a multiple of %zu\n",
+                       cpu, bw_kind_map(kind), sizeof(double));
+                exit(-1);
+            }
+        }
+
+        if (lat->set && CPU_ISSET(cpu, &args.lat_cpuset)) {
+            size_t count = lat->lat_cacheline_count ? lat->lat_cacheline_count : args.lat_cacheline_count;
+            size_t stride = lat->lat_cacheline_stride ? lat->lat_cacheline_stride : args.lat_cacheline_stride;
+
+            if (args.lat_shared_memory) {
+                printf("ERROR: -l %d: per-thread overrides cannot be used with a shared latency loop (-s)\n", cpu);
+                exit(-1);
+            }
+            if (lat->lat_cacheline_count && args.lat_size_count) {
+                printf("ERROR: -l %d: n= cannot be used with --lat-sizes\n", cpu);
+                exit(-1);
+            }
+            if (stride > count) {
+                printf("ERROR: -l %d: lat_cacheline_stride %zu > lat_cacheline_count %zu\n", cpu, stride, count);
+                exit(-1);
+            }
+            if (stride == count && args.lat_randomize) {
+                printf("ERROR: -l %d: lat_cacheline_stride == cacheline_count but with randomize = 1, can't do this\n", cpu);
+                exit(-1);
+            }
+        }
+    }
+}
+
+static void print_thread_overrides(int bw) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        const struct bw_override * ov = &args.bw_overrides[cpu];
+        const struct lat_override * lov = &args.lat_overrides[cpu];
+
+        if (bw && ov->set && CPU_ISSET(cpu, &args.bw_cpuset)) {
+            printf("CPU%d bandwidth thread    =", cpu);
+            if (ov->bw_kind >= 0)       printf(" bw_kind %s", bw_kind_map(ov->bw_kind));
+            if (ov->bw_buflen)          printf(" bw_buflen %zu", ov->bw_buflen);
+            if (ov->bw_inner_nops >= 0) printf(" bw_inner_nops %ld", ov->bw_inner_nops);
+            if (ov->bw_outer_nops >= 0) printf(" bw_outer_nops %ld", ov->bw_outer_nops);
+            if (ov->bw_iterations)      printf(" bw_iterations %zu", ov->bw_iterations);
+            printf("\n");
+        }
+
+        if (! bw && lov->set && CPU_ISSET(cpu, &args.lat_cpuset)) {
+            printf("CPU%d latency thread      =", cpu);
+            if (lov->lat_cacheline_count)  printf(" lat_cacheline_count %zu", lov->lat_cacheline_count);
+            if (lov->lat_cacheline_stride) printf(" lat_cacheline_stride %zu", lov->lat_cacheline_stride);
+            printf("\n");
+        }
+    }
+}
+
+/*
+ * print_thread_stats() summarizes the interim samples of each thread, and for
+ * more than one latency thread, the samples of all latency threads together.
+ * Unlike avg_latency, the latency statistics include the lowest sample.
+ */
+
+static void print_thread_stats(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+
+    struct sample_stats stats;
+    char label[64];
+    size_t total_lat_samples = 0;
+    double cntfreq = (double) read_cntfreq();
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        compute_sample_stats(bw_tinfo[i].samples.samples, bw_tinfo[i].samples.count, &stats);
+        snprintf(label, sizeof(label), "BWTHREAD%d bandwidth", bw_tinfo[i].thread_num);
+        print_sample_stats(label, &stats, 1e-6, "MB/sec");
+
+        double lines = 0.0;
+        for (size_t j = 0; j < bw_tinfo[i].samples.count; j++) {
+            const struct sample * s = &bw_tinfo[i].samples.samples[j];
+            lines += s->value * ((s->stop_tick - s->start_tick) / cntfreq) / bw_tinfo[i].bw_cacheline_bytes;
+        }
+        snprintf(label, sizeof(label), "BWTHREAD%d", bw_tinfo[i].thread_num);
+        print_perf_totals(label, &bw_tinfo[i].perf_group, &bw_tinfo[i].samples, lines, "line");
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        compute_sample_stats(lat_tinfo[i].samples.samples, lat_tinfo[i].samples.count, &stats);
+        snprintf(label, sizeof(label), "LATTHREAD%d latency", lat_tinfo[i].thread_num);
+        print_sample_stats(label, &stats, 1, "ns");
+        total_lat_samples += lat_tinfo[i].samples.count;
+
+        double loads = 0.0;
+        for (size_t j = 0; j < lat_tinfo[i].samples.count; j++) {
+            const struct sample * s = &lat_tinfo[i].samples.samples[j];
+            loads += (s->stop_tick - s->start_tick) / cntfreq * 1e9 / s->value * lat_tinfo[i].chains;
+        }
+        snprintf(label, sizeof(label), "LATTHREAD%d", lat_tinfo[i].thread_num);
+        print_perf_totals(label, &lat_tinfo[i].perf_group, &lat_tinfo[i].samples, loads, "load");
+
+        if (lat_tinfo[i].measure_cpu_freq) {
+            print_cpu_freq_stats(&lat_tinfo[i]);
+        }
+    }
+
+    if (num_lat_threads > 1) {
+        struct sample * all = malloc(total_lat_samples * sizeof(struct sample));
+        if (all == NULL && total_lat_samples > 0)
+            handle_error("malloc");
+
+        size_t n = 0;
+        for (int i = 0; i < num_lat_threads; i++) {
+            memcpy(&all[n], lat_tinfo[i].samples.samples, lat_tinfo[i].samples.count * sizeof(struct sample));
+            n += lat_tinfo[i].samples.count;
+        }
+
+        compute_sample_stats(all, n, &stats);
+        print_sample_stats("all latency threads", &stats, 1, "ns");
+        free(all);
+    }
+
+    printf("\n");
+}
+
+// the number of phases of --sweep-fine-delay, --lat-sizes or --bw-ramp, or 0 for a single phase
+
+static size_t sweep_phase_count(void) {
+    if (args.bw_ramp_step) {
+        return (CPU_COUNT(&args.bw_cpuset) + args.bw_ramp_step - 1) / args.bw_ramp_step;
+    }
+    return args.sweep_fine_delay_count ? args.sweep_fine_delay_count : args.lat_size_count;
+}
+
+// the bandwidth threads active in a phase; --bw-ramp adds bw_ramp_step of them per phase, up to all
+
+static int bw_ramp_threads(size_t phase, int num_bw_threads) {
+    if (args.bw_ramp_step && (phase + 1) * args.bw_ramp_step < (size_t) num_bw_threads) {
+        return (phase + 1) * args.bw_ramp_step;
+    }
+    return num_bw_threads;
+}
+
+/*
+ * The knee of --bw-ramp is the fewest active bandwidth threads that reach
+ * BW_RAMP_KNEE_FRACTION of the highest total bandwidth of the ramp.  Adding
+ * threads past the knee adds little bandwidth, only load.
+ */
+
+#define BW_RAMP_KNEE_FRACTION 0.95
+
+static void print_bw_ramp_knee(const double * bandwidth, size_t phases, int num_bw_threads) {
+    size_t max_k = 0, knee = 0;
+
+    for (size_t k = 0; k < phases; k++) {
+        if (bandwidth[k] > bandwidth[max_k]) {
+            max_k = k;
+        }
+    }
+
+    while (bandwidth[knee] < bandwidth[max_k] * BW_RAMP_KNEE_FRACTION) {
+        knee++;
+    }
+
+    printf("Bandwidth saturates at %d threads: %.6f MB/sec, %.0f%% of the highest %.6f MB/sec at %d threads\n",
+           bw_ramp_threads(knee, num_bw_threads), bandwidth[knee] / 1e6, 100 * bandwidth[knee] / bandwidth[max_k],
+           bandwidth[max_k] / 1e6, bw_ramp_threads(max_k, num_bw_threads));
+    if (max_k + 1 < phases) {
+        printf("Total bandwidth falls with more than %d threads\n", bw_ramp_threads(max_k, num_bw_threads));
+    }
+    printf("\n");
+}
+
+/*
+ * run_sweep() runs the phases of --sweep-fine-delay, --lat-sizes or
+ * --bw-ramp.  The threads are already running the first phase.  After all
+ * threads have finished a phase, its totals are printed in the same form as a
+ * single run so that summarize.sh still works on the output, and the next
+ * phase is published with the next fine delay or number of active bandwidth
+ * threads.  The buffers and the latency loop stay allocated for all of the
+ * phases; with --lat-sizes, each latency thread relinks its loop over the
+ * first cache lines of it for the next size before it finishes a phase.  With
+ * --bw-ramp, the inactive bandwidth threads are the last ones, so the totals
+ * of a phase are over the first bw_active_threads.
+ */
+
+static void run_sweep(struct phase_ctl * phase_ctl, struct stop_ctl * stop_ctl,
+        struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+
+    double bandwidth[MAX_SWEEP_STEPS];
+    double latency[MAX_SWEEP_STEPS];
+    size_t phases = sweep_phase_count();
+
+    struct sample_collector collector = { bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads };
+
+    unsigned long margin_ticks = PHASE_START_MARGIN_SECONDS * read_cntfreq();
+    unsigned long duration_ticks = read_cntfreq() * args.duration;
+
+    for (size_t k = 0; k < phases; k++) {
+
+        int active = bw_ramp_threads(k, num_bw_threads);
+
+        phase_wait_finished(phase_ctl, num_bw_threads + num_lat_threads, collect_samples, &collector);
+
+        // every thread pushed all of its samples of this phase before finishing it
+        collect_samples(&collector);
+        if (! args.live_samples) {
+            print_samples(bw_tinfo, active, lat_tinfo, num_lat_threads);
+        }
+
+        printf("\n");
+        if (args.sweep_fine_delay_count) {
+            printf("fine loop delay     (-F) = %zu\n", args.sweep_fine_delays[k]);
+        } else if (args.bw_ramp_step) {
+            printf("bw_threads              = %d\n", active);
+        } else {
+            printf("lat_size                = %zu bytes (%zu cachelines)\n",
+                   args.lat_sizes[k], args.lat_sizes[k] / args.lat_cacheline_bytes);
+        }
+
+        apply_concurrent_window(bw_tinfo, active, lat_tinfo, num_lat_threads);
+
+        bandwidth[k] = concurrent_bandwidth(bw_tinfo, active);
+        latency[k] = concurrent_latency(lat_tinfo, num_lat_threads);
+
+        print_total_bandwidth(bw_tinfo, active);
+        printf("Average Latency = %.6f ns\n\n", latency[k]);
+
+        print_thread_stats(bw_tinfo, active, lat_tinfo, num_lat_threads);
+
+        if (k + 1 == phases) {
+            phase_end(phase_ctl);
+            break;
+        }
+
+        for (int i = 0; i < num_bw_threads; i++) {
+            sample_reset(&bw_tinfo[i].samples);
+        }
+        for (int i = 0; i < num_lat_threads; i++) {
+            sample_reset(&lat_tinfo[i].samples);
+        }
+
+        stop_ctl->num_threads = bw_ramp_threads(k + 1, num_bw_threads) + num_lat_threads;
+        stop_reset(stop_ctl);
+
+        if (args.sweep_fine_delay_count) {
+            phase_ctl->bw_inner_nops = args.sweep_fine_delays[k + 1];
+        }
+        phase_ctl->bw_active_threads = bw_ramp_threads(k + 1, num_bw_threads);
+
+        unsigned long hwcounter_start = read_hwcounter() + margin_ticks;
+        phase_publish(phase_ctl, hwcounter_start, hwcounter_start + duration_ticks);
+    }
+
+    // the curve of the sweep, with one row per phase
+
+    printf("%s\tBandwidth\tLatency\n", args.sweep_fine_delay_count ? "F" : args.bw_ramp_step ? "Threads" : "Bytes");
+    for (size_t k = 0; k < phases; k++) {
+        size_t step = args.sweep_fine_delay_count ? args.sweep_fine_delays[k] :
+                      args.bw_ramp_step ? (size_t) bw_ramp_threads(k, num_bw_threads) : args.lat_sizes[k];
+        printf("%zu\t%.6f\t%.6f\n", step, bandwidth[k] / 1e6, latency[k]);
+    }
+    printf("\n");
+
+    if (args.bw_ramp_step) {
+        print_bw_ramp_knee(bandwidth, phases, num_bw_threads);
+    }
+}
+
+// the interim sample lines are the same whether printed live or after the threads finish
+
+static void print_sample_counts(const struct perf_group * group, const struct sample * sample) {
+    for (int k = 0; k < group->count; k++) {
+        printf(", %s = %lu", group->names[k], sample->counts[k]);
+    }
+    printf("\n");
+}
+
+static void print_bw_sample(const struct bw_thread_info * bw_tinfo, const struct sample * sample) {
+    int streams = bw_tinfo->read_streams + bw_tinfo->write_streams;
+
+    printf("CPU%d BWTHREAD%d: %f MB/sec", bw_tinfo->cpu, bw_tinfo->thread_num, sample->value / 1e6);
+    if (bw_tinfo->bw_kind == BW_KIND_ATOMIC) {
+        printf(", %f Mops/sec", sample->value / bw_tinfo->bw_cacheline_bytes / 1e6);
+    } else if (bw_tinfo->bw_pattern != BW_PATTERN_SEQUENTIAL) {
+        printf(", %f M%s/sec", sample->value / bw_tinfo->bw_cacheline_bytes / 1e6,
+               bw_pattern_updates(bw_tinfo, 1) ? "updates" : "accesses");
+    } else if (bw_tinfo->read_streams && bw_tinfo->write_streams) {
+        printf(" (%f read, %f write)", sample->value * bw_tinfo->read_streams / streams / 1e6,
+               sample->value * bw_tinfo->write_streams / streams / 1e6);
+    }
+    print_sample_counts(&bw_tinfo->perf_group, sample);
+}
+
+static void print_lat_sample(const struct lat_thread_info * lat_tinfo, const struct sample * sample) {
+    // with --measure-cpu-freq, the cycles are at the frequency measured in the interval
+    if (sample->core_mhz > 0) {
+        printf("CPU%d LATTHREAD%d: %.6f ns, %.6f cycles at %.3f MHz", lat_tinfo->cpu, lat_tinfo->thread_num,
+               sample->value, sample->value * sample->core_mhz / 1e3, sample->core_mhz);
+    } else {
+        printf("CPU%d LATTHREAD%d: %.6f ns, %.6f cycles", lat_tinfo->cpu, lat_tinfo->thread_num,
+               sample->value, sample->value / lat_tinfo->cycle_time_ns);
+    }
+    if (lat_tinfo->chains > 1) {
+        // the chain speedup, as defined with avg_chain_speedup in memlatency.h
+        printf(", %.3fx one chain", lat_tinfo->single_chain_latency * lat_tinfo->chains / sample->value);
+    }
+    print_sample_counts(&lat_tinfo->perf_group, sample);
+}
+
+/*
+ * collect_samples() moves the samples in the ring of each thread to its
+ * sample buffer, and with --live-samples, prints them as they arrive.
+ */
+
+static void collect_samples(void * arg) {
+    struct sample_collector * c = arg;
+
+    for (int i = 0; i < c->num_bw_threads; i++) {
+        struct sample_buf * buf = &c->bw_tinfo[i].samples;
+        size_t n = sample_ring_drain(&c->bw_tinfo[i].ring, buf);
+        if (args.live_samples) {
+            for (size_t j = buf->count - n; j < buf->count; j++) {
+                print_bw_sample(&c->bw_tinfo[i], &buf->samples[j]);
+            }
+        }
+    }
+
+    for (int i = 0; i < c->num_lat_threads; i++) {
+        struct sample_buf * buf = &c->lat_tinfo[i].samples;
+        size_t n = sample_ring_drain(&c->lat_tinfo[i].ring, buf);
+        if (args.live_samples) {
+            for (size_t j = buf->count - n; j < buf->count; j++) {
+                print_lat_sample(&c->lat_tinfo[i], &buf->samples[j]);
+            }
+        }
+    }
+}
+
+// without --live-samples, the samples are printed by thread after the threads finish
+
+static void print_samples(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        for (size_t j = 0; j < bw_tinfo[i].samples.count; j++) {
+            print_bw_sample(&bw_tinfo[i], &bw_tinfo[i].samples.samples[j]);
+        }
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        for (size_t j = 0; j < lat_tinfo[i].samples.count; j++) {
+            print_lat_sample(&lat_tinfo[i], &lat_tinfo[i].samples.samples[j]);
+        }
+    }
+}
+
+static void report_dropped_samples(const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        if (bw_tinfo[i].ring.dropped) {
+            printf("WARNING: BWTHREAD%d dropped %lu samples because its sample ring was full\n",
+                   bw_tinfo[i].thread_num, bw_tinfo[i].ring.dropped);
+        }
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        if (lat_tinfo[i].ring.dropped) {
+            printf("WARNING: LATTHREAD%d dropped %lu samples because its sample ring was full\n",
+                   lat_tinfo[i].thread_num, lat_tinfo[i].ring.dropped);
+        }
+    }
+}
+
+/*
+ * print_c2c_latency() prints the one-way latency matrix of the --c2c-cpus
+ * pairs, which is symmetric since each pair is measured once, and the
+ * fastest and slowest pairs.  A pair left unmeasured by the stop is "-".
+ */
+
+static void print_c2c_latency(const struct c2c_ctl * c2c_ctl, const struct c2c_thread_info * c2c_tinfo) {
+    int n = c2c_ctl->num_threads;
+    int pairs = n * (n - 1) / 2, measured = 0;
+    int min_a = 0, min_b = 0, max_a = 0, max_b = 0;
+    double sum = 0.0;
+
+    printf("core-to-core latency, one way in ns (%s handoff, %zu round trips per pair):\n\n",
+           c2c_mode_map(c2c_ctl->mode), c2c_ctl->iterations);
+
+    printf("%8s", "");
+    for (int b = 0; b < n; b++) {
+        char label[16];
+        snprintf(label, sizeof(label), "CPU%d", c2c_tinfo[b].cpu);
+        printf(" %8s", label);
+    }
+    printf("\n");
+
+    for (int a = 0; a < n; a++) {
+        printf("CPU%-5d", c2c_tinfo[a].cpu);
+        for (int b = 0; b < n; b++) {
+            double ns = c2c_ctl->latency[a * n + b];
+            if (ns > 0) {
+                printf(" %8.1f", ns);
+            } else {
+                printf(" %8s", "-");
+            }
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    for (int a = 0; a < n; a++) {
+        for (int b = a + 1; b < n; b++) {
+            double ns = c2c_ctl->latency[a * n + b];
+            if (ns == 0) {
+                continue;
+            }
+            if (measured == 0 || ns < c2c_ctl->latency[min_a * n + min_b]) {
+                min_a = a;
+                min_b = b;
+            }
+            if (measured == 0 || ns > c2c_ctl->latency[max_a * n + max_b]) {
+                max_a = a;
+                max_b = b;
+            }
+            sum += ns;
+            measured++;
+        }
+    }
+
+    if (measured) {
+        printf("c2c pairs measured = %d of %d, mean = %.1f ns, min = %.1f ns (CPU%d-CPU%d), max = %.1f ns (CPU%d-CPU%d)\n",
+               measured, pairs, sum / measured,
+               c2c_ctl->latency[min_a * n + min_b], c2c_tinfo[min_a].cpu, c2c_tinfo[min_b].cpu,
+               c2c_ctl->latency[max_a * n + max_b], c2c_tinfo[max_a].cpu, c2c_tinfo[max_b].cpu);
+    }
+    if (measured < pairs) {
+        printf("WARNING: only %d of %d core-to-core pairs were measured before the stop.  Increase --duration or decrease --c2c-iterations.\n",
+               measured, pairs);
+    }
+    printf("\n");
+}
+
+// the node list is repeated when there are more threads than nodes listed
+
+static int mem_node_for_thread(const int * mem_nodes, int mem_node_count, size_t thread_num) {
+    if (mem_node_count == 0) {
+        return MEM_NODE_NONE;
+    }
+    return mem_nodes[thread_num % mem_node_count];
+}
+
+static void print_mem_nodes(const int * mem_nodes, int mem_node_count) {
+    if (mem_node_count == 0) {
+        printf("none (default NUMA memory policy)\n");
+        return;
+    }
+    for (int i = 0; i < mem_node_count; i++) {
+        printf("%s%d", i ? "," : "", mem_nodes[i]);
+    }
+    printf("\n");
+}
+
 unsigned long estimate_hwclock_freq(long cpu_num, size_t n, int verbose, struct timeval target_measurement_duration) {
 
     unsigned long hwcounter_start, hwcounter_stop, hwcounter_diff;
@@ -29,14 +29,155 @@
 #endif
 
 #include "alloc.h"
+#include "phase.h"
+#include "stats.h"
+#include "perf.h"
+#include "cpufreq.h"
+#include "rng.h"
 #include "memlatency.h"
 
-/* lat_initialize can be called from main.c for shared memory */
+/*
+ * The latency loop is built in one pass by up to MAX_LAT_INIT_WORKERS
+ * threads, each of which handles one page-aligned range of positions of the
+ * ordering.  A random ordering is a uniform random permutation made in
+ * parallel by bucketing: each worker sends each of its positions to a random
+ * bucket (one per worker), the buckets are concatenated, and each worker then
+ * shuffles its own bucket with Fisher-Yates.  Since the ordering is linked in
+ * sequence, any permutation makes a single loop (or chains loops).
+ */
 
-void ** lat_initialize(size_t cacheline_bytes,
-    size_t cacheline_count, int randomize, int clear_cache, size_t cacheline_stride, int use_hugepages) {
+struct lat_init {
+    char *          base;
+    size_t          cacheline_bytes;
+    size_t          cacheline_stride;
+    size_t          positions;          // number of nodes in the loop(s)
+    size_t          chains;
+    int             randomize;
+    size_t          workers;
+    size_t          page_positions;     // positions per page, for partitioning
+    size_t *        order;              // node number at each position
+    size_t *        bucket_counts;      // [worker][bucket] number of positions sent
+    pthread_barrier_t barrier;
+};
+
+struct lat_init_worker {
+    struct lat_init * init;
+    size_t          worker;
+    int             cpu;
+    struct rng      rng;                // seeded from the loop seed and the worker number
+    pthread_t       thread_id;
+};
+
+typedef struct {
+    void * next;
+    size_t order;
+    size_t index;
+} partial_node_t;
+
+static partial_node_t * init_node(const struct lat_init * init, size_t node_num) {
+    return (partial_node_t *) (init->base + node_num * init->cacheline_bytes);
+}
 
-    size_t i;
+// range of positions of a worker, with boundaries on pages of nodes
+
+static void init_range(const struct lat_init * init, size_t worker, size_t * lo, size_t * hi) {
+    size_t pages = (init->positions + init->page_positions - 1) / init->page_positions;
+
+    *lo = pages * worker / init->workers * init->page_positions;
+    *hi = pages * (worker + 1) / init->workers * init->page_positions;
+
+    if (*lo > init->positions) {
+        *lo = init->positions;
+    }
+    if (*hi > init->positions) {
+        *hi = init->positions;
+    }
+}
+
+static void * lat_init_worker(void * arg) {
+    struct lat_init_worker * w = arg;
+    struct lat_init * init = w->init;
+    size_t workers = init->workers;
+    size_t * counts = init->bucket_counts + w->worker * workers;
+    size_t lo, hi, i;
+
+    init_range(init, w->worker, &lo, &hi);
+
+    if (! init->randomize) {
+        for (i = lo; i < hi; i++) {
+            init->order[i] = i * init->cacheline_stride;
+        }
+    } else {
+        struct rng rng = w->rng;
+
+        // count the positions going to each bucket
+
+        for (i = lo; i < hi; i++) {
+            counts[rng_below(&rng, workers)]++;
+        }
+
+        pthread_barrier_wait(&init->barrier);
+
+        // bucket b is at the sum of all buckets before b, then of this worker's predecessors in bucket b
+
+        size_t offset[workers];
+        size_t sum = 0, my_bucket_lo = 0, my_bucket_hi = 0;
+
+        for (size_t b = 0; b < workers; b++) {
+            if (b == w->worker) {
+                my_bucket_lo = sum;
+            }
+            for (size_t v = 0; v < workers; v++) {
+                if (v == w->worker) {
+                    offset[b] = sum;
+                }
+                sum += init->bucket_counts[v * workers + b];
+            }
+            if (b == w->worker) {
+                my_bucket_hi = sum;
+            }
+        }
+
+        // send the same positions to the same buckets by replaying the random numbers
+
+        rng = w->rng;
+
+        for (i = lo; i < hi; i++) {
+            init->order[offset[rng_below(&rng, workers)]++] = i * init->cacheline_stride;
+        }
+
+        pthread_barrier_wait(&init->barrier);
+
+        // Fisher-Yates shuffle of this worker's bucket
+
+        size_t * bucket = init->order + my_bucket_lo;
+
+        for (i = my_bucket_hi - my_bucket_lo; i > 1; i--) {
+            size_t j = rng_below(&rng, i);
+            size_t x = bucket[i - 1];
+            bucket[i - 1] = bucket[j];
+            bucket[j] = x;
+        }
+    }
+
+    pthread_barrier_wait(&init->barrier);
+
+    // create the pointer loops using the ordering.  Chain k visits
+    // every chains-th position of the ordering, starting at position k.
+
+    for (i = lo; i < hi; i++) {
+        size_t next = (i + init->chains < init->positions) ? i + init->chains : i % init->chains;
+        partial_node_t * node = init_node(init, init->order[i]);
+
+        node->next = init_node(init, init->order[next]);
+        node->index = i * init->cacheline_stride;
+        init_node(init, i * init->cacheline_stride)->order = init->order[i];
+    }
+
+    return NULL;
+}
+
+void ** lat_alloc(size_t cacheline_bytes, size_t cacheline_count, int use_hugepages, int mem_node) {
 
     typedef struct {
         void * next;
@@ -57,64 +198,136 @@ void ** lat_initialize(size_t cacheline_bytes,
         exit(-1);
     }
 
-    node_t * p = do_alloc(cacheline_bytes * cacheline_count, use_hugepages, cacheline_bytes);
+    return do_alloc(cacheline_bytes * cacheline_count, use_hugepages, cacheline_bytes, mem_node);
+}
+
+/* lat_link() builds the loop over the first cacheline_count cache lines of
+   mem.  If init_cpus is not NULL, the loop is built by one thread on each of
+   those CPUs.  The random ordering depends only on seed, stream (e.g. the
+   latency thread number) and the number of those CPUs. */
 
-    // order is the sequence of node_t elements to traverse.  Initialize for sequential order.
+void lat_link(void ** mem, size_t cacheline_bytes, size_t cacheline_count, int randomize, size_t cacheline_stride,
+    size_t chains, const cpu_set_t * init_cpus, unsigned long seed, size_t stream) {
 
-    for (i = 0; i < cacheline_count; i++) {
-        p[i].order = i;
+    size_t i;
+
+    size_t positions = (cacheline_count + cacheline_stride - 1) / cacheline_stride;
+
+    if (positions < chains) {
+        printf("lat_chains = %zu is more than the %zu cachelines to be visited\n", chains, positions);
+        exit(-1);
+    }
+
+    struct lat_init init = {
+        .base = (char *) mem,
+        .cacheline_bytes = cacheline_bytes,
+        .cacheline_stride = cacheline_stride,
+        .positions = positions,
+        .chains = chains,
+        .randomize = randomize,
+        .workers = 1,
+    };
+
+    init.page_positions = sysconf(_SC_PAGESIZE) / (cacheline_bytes * cacheline_stride);
+    if (init.page_positions == 0) {
+        init.page_positions = 1;
+    }
+
+    if (init_cpus && CPU_COUNT(init_cpus) > 1) {
+        init.workers = CPU_COUNT(init_cpus);
+    }
+
+    // order is the sequence of node_t elements to traverse
+
+    init.order = malloc(positions * sizeof(size_t));
+    init.bucket_counts = calloc(init.workers * init.workers, sizeof(size_t));
+    struct lat_init_worker * w = calloc(init.workers, sizeof(struct lat_init_worker));
+
+    if (init.order == NULL || init.bucket_counts == NULL || w == NULL) {
+        printf("lat_initialize: could not allocate the ordering for %zu cachelines\n", positions);
+        exit(-1);
     }
 
-    // if randomize is used, randomly swap the order values
+    pthread_barrier_init(&init.barrier, NULL, init.workers);
 
-    if (randomize) {
-        for (int rounds = 0; rounds < 10; rounds++) {
-            for (i = 0; i < cacheline_count; i+= cacheline_stride) {
-                size_t offset_a, offset_b, x;
+    int cpu = -1;
 
-                do {
-                    offset_a = (lrand48() % (cacheline_count/cacheline_stride)) * cacheline_stride;
-                    offset_b = (lrand48() % (cacheline_count/cacheline_stride)) * cacheline_stride;
-                } while (offset_a == offset_b);
+    for (i = 0; i < init.workers; i++) {
+        w[i].init = &init;
+        w[i].worker = i;
 
-                x = p[offset_a].order;
-                p[offset_a].order = p[offset_b].order;
-                p[offset_b].order = x;
+        rng_seed(&w[i].rng, seed, stream * init.workers + i);
+
+        if (init.workers > 1) {
+            while (! CPU_ISSET(++cpu, init_cpus)) {
+                ;
             }
+            w[i].cpu = cpu;
+        }
+    }
+
+    // worker 0 is this thread, which the caller has placed on the first CPU
+
+    for (i = 1; i < init.workers; i++) {
+        pthread_attr_t attr;
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(w[i].cpu, &cpuset);
+        pthread_attr_init(&attr);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+
+        if (pthread_create(&w[i].thread_id, &attr, lat_init_worker, &w[i])) {
+            printf("lat_initialize: could not create worker thread on CPU%d\n", w[i].cpu);
+            exit(-1);
         }
+
+        pthread_attr_destroy(&attr);
     }
 
-    // create the pointer loop using the ordering table
+    lat_init_worker(&w[0]);
 
-    for (i = 0; i < cacheline_count - cacheline_stride; i += cacheline_stride) {
-        p[p[i].order].next = &(p[p[i + cacheline_stride].order].next);
-        p[p[i].order].index = i;
+    for (i = 1; i < init.workers; i++) {
+        pthread_join(w[i].thread_id, NULL);
     }
 
-    p[p[i].order].next = &(p[p[0].order].next);
-    p[p[i].order].index = i;
+    pthread_barrier_destroy(&init.barrier);
+    free(w);
+    free(init.bucket_counts);
+    free(init.order);
 
 #if 0
     // print out latency loop pointers for debug
     printf("by pointer:\n");
-    node_t * pp = (node_t *) ppvoid;
+    partial_node_t * pp = (partial_node_t *) mem;
     for (i = 0; i < cacheline_count; i++) {
         printf("%zu\tpp=%p pp->next=%p delta=%ld bytes\n", i, pp, pp->next, (long) pp->next - (long) pp );
         pp = pp->next;
     }
 
     printf("by entry:\n");
-    pp = (node_t *) ppvoid;
+    pp = (partial_node_t *) mem;
     for (i = 0; i < cacheline_count; i++) {
-        printf("pp[%zu]\t= %p, .next=%p\n", i, &(pp[i]), pp[i].next);
+        printf("pp[%zu]\t= %p, .next=%p\n", i, init_node(&init, i), init_node(&init, i)->next);
     }
 #endif
+}
+
+/* lat_initialize can be called from main.c for shared memory. */
+
+void ** lat_initialize(size_t cacheline_bytes,
+    size_t cacheline_count, int randomize, int clear_cache, size_t cacheline_stride, int use_hugepages, int mem_node,
+    size_t chains, const cpu_set_t * init_cpus, unsigned long seed, size_t stream) {
+
+    void ** mem = lat_alloc(cacheline_bytes, cacheline_count, use_hugepages, mem_node);
+
+    lat_link(mem, cacheline_bytes, cacheline_count, randomize, cacheline_stride, chains, init_cpus, seed, stream);
 
     if (clear_cache) {
-        __builtin___clear_cache(p, p+cacheline_count);
+        __builtin___clear_cache((char *) mem, (char *) mem + cacheline_bytes * cacheline_count);
     }
 
-    return (void **) p;
+    return mem;
 }
 
 
@@ -154,134 +367,374 @@ static void ** run(void ** p, size_t iterations) {
 }
 
 
+/* run_chains() follows chains independent pointer chains together, so up to
+   chains loads can be in flight at a time.  Each chain has its own local
+   variable so that the chains are not serialized through memory. */
+
+static void run_chains(void ** heads[], size_t chains, size_t iterations) __attribute__((noinline));
+static void run_chains(void ** heads[], size_t chains, size_t iterations) {
+    void ** c0  = heads[0],  ** c1  = heads[1],  ** c2  = heads[2],  ** c3  = heads[3];
+    void ** c4  = heads[4],  ** c5  = heads[5],  ** c6  = heads[6],  ** c7  = heads[7];
+    void ** c8  = heads[8],  ** c9  = heads[9],  ** c10 = heads[10], ** c11 = heads[11];
+    void ** c12 = heads[12], ** c13 = heads[13], ** c14 = heads[14], ** c15 = heads[15];
+
+#define CHAIN(n) case (n) + 1: c##n = (void **) (*c##n);
+
+    // 10 loads per chain per iteration, like run()
+    for (size_t i = 0; i < iterations * 10; i++) {
+        switch (chains) {
+            CHAIN(15) CHAIN(14) CHAIN(13) CHAIN(12) CHAIN(11) CHAIN(10) CHAIN(9) CHAIN(8)
+            CHAIN(7)  CHAIN(6)  CHAIN(5)  CHAIN(4)  CHAIN(3)  CHAIN(2)  CHAIN(1) CHAIN(0)
+        }
+    }
+
+    heads[0]  = c0;  heads[1]  = c1;  heads[2]  = c2;  heads[3]  = c3;
+    heads[4]  = c4;  heads[5]  = c5;  heads[6]  = c6;  heads[7]  = c7;
+    heads[8]  = c8;  heads[9]  = c9;  heads[10] = c10; heads[11] = c11;
+    heads[12] = c12; heads[13] = c13; heads[14] = c14; heads[15] = c15;
+}
+
+/* The iterations of one interval are run in chunks of LAT_STOP_CHUNK_ITERATIONS
+   so that the stop_ctl is polled often regardless of --lat-iterations.  Each
+   poll costs about one hwcounter read per 10 * LAT_STOP_CHUNK_ITERATIONS loads. */
+
+#define LAT_STOP_CHUNK_ITERATIONS 1000
+
+/* The head of chain k is the node at position k of the ordering, which is
+   found through the order field of the node at that position. */
+
+static void ** chain_head(void ** mem, size_t cacheline_bytes, size_t cacheline_stride, size_t k) {
+    partial_node_t * node = (partial_node_t *) ((char *) mem + k * cacheline_stride * cacheline_bytes);
+
+    return (void **) ((char *) mem + node->order * cacheline_bytes);
+}
+
+/* prepare_loop() sets up the loop of cacheline_count cache lines for
+   measuring: it warms the loop up if asked, advances p or the chain heads to
+   lat_offset, and with multiple chains, measures and returns the latency of
+   one chain followed alone.  It returns 0 for one chain. */
+
+static double prepare_loop(struct lat_thread_info * lat_tinfo, void ** mem, size_t cacheline_count,
+        void *** pp, void ** heads[]) {
+    size_t cacheline_bytes                    = lat_tinfo->lat_cacheline_bytes;
+    size_t cacheline_stride                   = lat_tinfo->cacheline_stride;
+    size_t iterations                         = lat_tinfo->iterations;
+    size_t lat_offset                         = lat_tinfo->lat_offset;
+    size_t chains                             = lat_tinfo->chains;
+    int thread_num                            = lat_tinfo->thread_num;
+    int cpu                                   = lat_tinfo->cpu;
+
+    unsigned long interval_start, interval_stop;
+    double cntfreq = (double) read_cntfreq();
+
+    void ** p = mem;
+
+    if (chains == 1) {
+
+        // warm-up read
+
+        if (lat_tinfo->warmup) {
+            p = run(p, cacheline_count); // this will do 10 full-reads because there are 10 deploads per iteration in run()
+            printf("CPU%d LATTHREAD%d: warmed up\n", cpu, thread_num);
+        }
+        p = run(p, lat_offset / 10);    // advance p to start offset. / 10 because there are 10 deploads per iteration in run()
+        *pp = p;
+
+        return 0.0;
+    }
+
+    for (size_t k = 0; k < chains; k++) {
+        heads[k] = chain_head(mem, cacheline_bytes, cacheline_stride, k);
+    }
+
+    // each chain is 1/chains of the cache lines, so both the warm-up and the offset are split between them
+
+    if (lat_tinfo->warmup) {
+        run_chains(heads, chains, cacheline_count / chains);
+        printf("CPU%d LATTHREAD%d: warmed up\n", cpu, thread_num);
+    }
+    run_chains(heads, chains, lat_offset / chains / 10);
+
+    // the latency of one chain followed alone, for computing the chain speedup of all chains
+
+    p = heads[0];
+    interval_start = read_hwcounter_start();
+    p = run(p, iterations);
+    interval_stop = read_hwcounter_stop();
+    heads[0] = p;
+    *pp = p;
+
+    double unloaded_latency = (interval_stop - interval_start) / cntfreq * 1e9 / (iterations * 10);
+    lat_tinfo->single_chain_latency = unloaded_latency;
+
+    printf("CPU%d LATTHREAD%d: chains = %zu, single chain latency before start = %.6f ns\n",
+           cpu, thread_num, chains, unloaded_latency);
+
+    return unloaded_latency;
+}
 
 void latency_thread (struct lat_thread_info * lat_tinfo) {
     size_t cacheline_bytes                    = lat_tinfo->lat_cacheline_bytes;
     size_t cacheline_count                    = lat_tinfo->cacheline_count;
     size_t iterations                         = lat_tinfo->iterations;
-    double cycle_time_ns                      = lat_tinfo->cycle_time_ns;
     int thread_num                            = lat_tinfo->thread_num;
     int cpu                                   = lat_tinfo->cpu;
-    unsigned long hwcounter_start             = lat_tinfo->hwcounter_start;
-    unsigned long hwcounter_stop              = lat_tinfo->hwcounter_stop;
+    unsigned long hwcounter_start, hwcounter_stop;
+    unsigned long start_delay                 = lat_tinfo->start_delay;
     int randomize                             = lat_tinfo->randomize;
     int use_hugepages                         = lat_tinfo->use_hugepages;
+    int mem_node                              = lat_tinfo->mem_node;
     void ** mem                               = lat_tinfo->mem;
     size_t lat_offset                         = lat_tinfo->lat_offset;
     int lat_clear_cache                       = lat_tinfo->lat_clear_cache;
-    int warmup                                = lat_tinfo->warmup;
     size_t cacheline_stride                   = lat_tinfo->cacheline_stride;
-
-    double avg_latency = 0.0;
-    double min_latency = INFINITY;
-    unsigned long latency_samples = 0;
+    size_t chains                             = lat_tinfo->chains;
+    unsigned long random_seed                 = lat_tinfo->random_seed;
+
+    struct phase_ctl * phase_ctl              = lat_tinfo->phase_ctl;
+    struct start_ctl * start_ctl              = lat_tinfo->start_ctl;
+    struct stop_ctl * stop_ctl                = lat_tinfo->stop_ctl;
+    int phase = 0;
+
+    double avg_latency;
+    double min_latency;
+    double avg_chain_speedup;
+    double unloaded_latency = 0.0;
+    unsigned long latency_samples;
     unsigned long start_tick, stop_tick;
 
-    struct timeval t0, t1, tdiff;
+    unsigned long interval_start, interval_stop;
+    double cntfreq = (double) read_cntfreq();
 
     // if mem is not NULL, then it has been preinitalized.
 
-    if (mem == NULL) {
-        mem = lat_initialize(cacheline_bytes, cacheline_count, randomize, lat_clear_cache, cacheline_stride, use_hugepages);
+    if (mem == NULL && lat_tinfo->lat_sizes) {
+
+        // --lat-sizes: allocate once for the largest size, and loop over the first cache lines of it in each phase
+
+        size_t max_count = cacheline_count;
+        for (size_t k = 0; k < lat_tinfo->lat_size_count; k++) {
+            if (lat_tinfo->lat_sizes[k] / cacheline_bytes > max_count) {
+                max_count = lat_tinfo->lat_sizes[k] / cacheline_bytes;
+            }
+        }
+
+        mem = lat_alloc(cacheline_bytes, max_count, use_hugepages, mem_node);
+        lat_link(mem, cacheline_bytes, cacheline_count, randomize, cacheline_stride, chains, NULL, random_seed, thread_num);
+        if (lat_clear_cache) {
+            __builtin___clear_cache((char *) mem, (char *) mem + cacheline_bytes * cacheline_count);
+        }
+
+        char label[64];
+        snprintf(label, sizeof(label), "CPU%d LATTHREAD%d: memory", cpu, thread_num);
+        report_mem_nodes(label, mem, cacheline_bytes * max_count);
+
+    } else if (mem == NULL) {
+        mem = lat_initialize(cacheline_bytes, cacheline_count, randomize, lat_clear_cache, cacheline_stride, use_hugepages, mem_node, chains, NULL,
+                random_seed, thread_num);
+
+        char label[64];
+        snprintf(label, sizeof(label), "CPU%d LATTHREAD%d: memory", cpu, thread_num);
+        report_mem_nodes(label, mem, cacheline_bytes * cacheline_count);
     }
 
     void ** p = mem;
+    void ** heads[MAX_LAT_CHAINS] = { NULL };
 
-    // warm-up read
+    unloaded_latency = prepare_loop(lat_tinfo, mem, cacheline_count, &p, heads);
 
-    if (warmup) {
-        p = run(p, cacheline_count); // this will do 10 full-reads because there are 10 deploads per iteration in run()
-        printf("CPU%d LATTHREAD%d: warmed up\n", cpu, thread_num);
+    unsigned long counts[SAMPLE_MAX_COUNTERS];
+
+    if (lat_tinfo->perf) {
+        char label[64];
+        snprintf(label, sizeof(label), "CPU%d LATTHREAD%d", cpu, thread_num);
+        perf_open(&lat_tinfo->perf_group, label);
     }
-    p = run(p, lat_offset / 10);    // advance p to start offset. / 10 because there are 10 deploads per iteration in run()
 
-    printf("CPU%d LATTHREAD%d: cacheline_count = %zu, iterations = %zu, mem = %p, randomize = %d, use_hugepages = %d, hwcounter_start = 0x%zx, lat_offset = %zu, tid = %d\n",
-           cpu, thread_num, cacheline_count, iterations, mem, randomize,
-           use_hugepages, hwcounter_start, lat_offset, gettid());
+    double core_mhz = 0.0;
 
-    // wait until hwcounter reaches the expected value
-    while ((start_tick = read_hwcounter()) < hwcounter_start) {
-        ;
+    if (lat_tinfo->measure_cpu_freq) {
+        char label[64];
+        snprintf(label, sizeof(label), "CPU%d LATTHREAD%d", cpu, thread_num);
+        cpu_freq_open(&lat_tinfo->cpu_freq, cpu, label);
     }
 
-    lat_tinfo->actual_hwcounter_start = start_tick;
+    // tell the main thread that this thread is ready, and wait for it to publish the start
+
+    start_ready(start_ctl);
+
+    hwcounter_start = lat_tinfo->hwcounter_start = start_ctl->hwcounter_start + start_delay;
+    hwcounter_stop  = lat_tinfo->hwcounter_stop  = start_ctl->hwcounter_stop + start_delay;
+
+    printf("CPU%d LATTHREAD%d: cacheline_count = %zu, iterations = %zu, mem = %p, randomize = %d, use_hugepages = %d, mem_node = %d, hwcounter_start = 0x%zx, lat_offset = %zu, chains = %zu, tid = %d\n",
+           cpu, thread_num, cacheline_count, iterations, mem, randomize,
+           use_hugepages, mem_node, hwcounter_start, lat_offset, chains, gettid());
+
+    // each pass of this loop is one phase; there is only one unless phase_ctl is used
+
+    while (1) {
+
+        avg_latency = 0.0;
+        min_latency = INFINITY;
+        avg_chain_speedup = 0.0;
+        latency_samples = 0;
+
+        // wait until hwcounter reaches the expected value
+        while ((start_tick = read_hwcounter()) < hwcounter_start) {
+            ;
+        }
+
+        lat_tinfo->actual_hwcounter_start = start_tick;
+
+        // XXX: this printf has overhead
+        printf("CPU%d LATTHREAD%d: started at " HWCOUNTER " = 0x%zx\n", cpu, thread_num, start_tick);
+
+        size_t last_hwcounter = start_tick;
 
-    // XXX: this printf has overhead
-    printf("CPU%d LATTHREAD%d: started at " HWCOUNTER " = 0x%zx\n", cpu, thread_num, start_tick);
+        stop_tick = read_hwcounter();
 
-    size_t last_hwcounter = start_tick;
+        if (stop_tick < hwcounter_stop) {
+            int stopped = 0;
 
-    stop_tick = read_hwcounter();
+            do {
+                size_t done = 0;
 
-    if (stop_tick < hwcounter_stop) {
-        do {
-            gettimeofday(&t0, NULL);
+                // the perf and cpufreq reads are system calls, so they are outside of the timed interval
+                if (lat_tinfo->measure_cpu_freq) {
+                    cpu_freq_start(&lat_tinfo->cpu_freq);
+                }
+                perf_start(&lat_tinfo->perf_group);
 
-            p = run(p, iterations);
+                interval_start = read_hwcounter_start();
 
-            gettimeofday(&t1, NULL);
+                while (done < iterations) {
+                    size_t chunk = iterations - done < LAT_STOP_CHUNK_ITERATIONS ? iterations - done : LAT_STOP_CHUNK_ITERATIONS;
 
-            timersub(&t1, &t0, &tdiff);
+                    if (chains == 1) {
+                        p = run(p, chunk);
+                    } else {
+                        run_chains(heads, chains, chunk);
+                    }
+                    done += chunk;
 
-            double x = tdiff.tv_sec;    // x is elapsed time for loop. Here it is in seconds.
-            x += tdiff.tv_usec / 1e6;
+                    if (stop_check(stop_ctl, read_hwcounter(), hwcounter_stop)) {
+                        stopped = 1;
+                        break;
+                    }
+                }
 
-            double x_per_iter = x;
-            x_per_iter *= 1e9;
-            x_per_iter /= iterations * 10;  // latency for this iteration
+                interval_stop = read_hwcounter_stop();
 
-            size_t this_hwcounter = read_hwcounter();
+                perf_stop(&lat_tinfo->perf_group, counts);
+                if (lat_tinfo->measure_cpu_freq) {
+                    core_mhz = cpu_freq_stop(&lat_tinfo->cpu_freq, interval_stop - interval_start);
+                }
+
+                double x = (interval_stop - interval_start) / cntfreq;  // x is elapsed time for loop. Here it is in seconds.
+
+                double x_per_iter = x;
+                x_per_iter *= 1e9;
+                x_per_iter /= done * 10;  // latency for this iteration; each chain does 10 deploads per iteration.  The last may be short because of the stop.
+
+                // the chain speedup, as defined with avg_chain_speedup in memlatency.h
+                double chain_speedup = unloaded_latency * chains / x_per_iter;
 
 #if 0
-            typedef struct {
-                void * next;
-                size_t order;
-                size_t index;
-            } partial_node_t;
+                typedef struct {
+                    void * next;
+                    size_t order;
+                    size_t index;
+                } partial_node_t;
 
-            size_t current_index = ((partial_node_t *) p)->index;
+                size_t current_index = ((partial_node_t *) p)->index;
 
-            printf("CPU%d LATTHREAD%d: %.6f ns, %.6f cycles, cntvct=0x%08lx cntvct_diff=%lu p=%p index=%zu latency_samples=%zu\n",
-                    cpu, thread_num, x_per_iter, x_per_iter/cycle_time_ns, this_hwcounter,
-                    this_hwcounter - last_hwcounter, p, current_index, latency_samples);
-#else
-            printf("CPU%d LATTHREAD%d: %.6f ns, %.6f cycles\n", cpu, thread_num, x_per_iter, x_per_iter/cycle_time_ns);
+                printf("CPU%d LATTHREAD%d: %.6f ns, %.6f cycles, cntvct=0x%08lx cntvct_diff=%lu p=%p index=%zu latency_samples=%zu\n",
+                        cpu, thread_num, x_per_iter, x_per_iter/lat_tinfo->cycle_time_ns, interval_stop,
+                        interval_stop - interval_start, p, current_index, latency_samples);
 #endif
 
-            last_hwcounter = this_hwcounter;
+                // the main thread prints the sample, so that printf is not in the measurement
+                sample_ring_push(&lat_tinfo->ring, interval_start, interval_stop, x_per_iter, core_mhz, counts);
+
+                last_hwcounter = interval_stop;
+
+                if (x_per_iter < min_latency) {
+                    min_latency = x_per_iter;
+                }
+
+                avg_latency += x_per_iter;
+                avg_chain_speedup += chain_speedup;
+                latency_samples++;
+            } while (! stopped && last_hwcounter < hwcounter_stop);
+            stop_tick = last_hwcounter;
+        } else {
+            unsigned long tick_deficit = stop_tick - hwcounter_stop;
+            double tick_deficit_seconds = tick_deficit / (double) read_cntfreq();
+
+            printf("CPU%d LATTHREAD%d: the hwclock has passed the expected "
+            "stop time without any measurements.  Use --delay-seconds to "
+            "increase the margin for threads to see the published start.  A "
+            "suggested value to add to the current value is %f\n",
+            cpu, thread_num, tick_deficit_seconds);
+        }
+
+        lat_tinfo->actual_hwcounter_stop = stop_tick;
 
-            if (x_per_iter < min_latency) {
-                min_latency = x_per_iter;
+        // keep loading memory until every thread has stopped measuring
+        stop_arrive(stop_ctl);
+        while (stop_draining(stop_ctl)) {
+            if (chains == 1) {
+                p = run(p, LAT_STOP_CHUNK_ITERATIONS);
+            } else {
+                run_chains(heads, chains, LAT_STOP_CHUNK_ITERATIONS);
             }
+        }
 
-            avg_latency += x_per_iter;
-            latency_samples++;
-        } while (last_hwcounter < hwcounter_stop);
-        stop_tick = last_hwcounter;
-    } else {
-        unsigned long tick_deficit = stop_tick - hwcounter_stop;
-        double tick_deficit_seconds = tick_deficit / (double) read_cntfreq();
-
-        printf("CPU%d LATTHREAD%d: the hwclock has passed the expected "
-        "stop time without any measurements.  Use --delay-seconds to "
-        "increase delay time for threads to do their setup.  A "
-        "suggested value to add to the current value is %f\n",
-        cpu, thread_num, tick_deficit_seconds);
-    }
+        // drop lowest latency if there is more than 1 sample
+        // because it may be an unencumbered trailing iteration
+
+        if (latency_samples > 1) {
+            avg_latency -= min_latency;
+            avg_chain_speedup -= unloaded_latency * chains / min_latency;
+            latency_samples--;
+        }
+
+        avg_latency /= latency_samples;
+        avg_chain_speedup /= latency_samples;
+
+        lat_tinfo->avg_latency = avg_latency;
+        lat_tinfo->avg_chain_speedup = avg_chain_speedup;
+
+        // --lat-sizes: build the loop of the next phase before finishing this one, so the main thread waits for it
+
+        if (lat_tinfo->lat_sizes && phase + 1 < (int) lat_tinfo->lat_size_count) {
+            cacheline_count = lat_tinfo->lat_sizes[phase + 1] / cacheline_bytes;
+            lat_link(mem, cacheline_bytes, cacheline_count, randomize, cacheline_stride, chains, NULL, random_seed, thread_num);
+            if (lat_clear_cache) {
+                __builtin___clear_cache((char *) mem, (char *) mem + cacheline_bytes * cacheline_count);
+            }
 
-    asm volatile ("" : : "r" (p));  // force p to be "used"
+            printf("CPU%d LATTHREAD%d: phase %d, loop of %zu bytes (%zu cachelines)\n",
+                   cpu, thread_num, phase + 1, cacheline_count * cacheline_bytes, cacheline_count);
 
-    lat_tinfo->actual_hwcounter_stop = stop_tick;
+            unloaded_latency = prepare_loop(lat_tinfo, mem, cacheline_count, &p, heads);
+        }
 
-    // drop lowest latency if there is more than 1 sample
-    // because it may be an unencumbered trailing iteration
+        if (phase_ctl == NULL || ! phase_wait_next(phase_ctl, &phase)) {
+            break;
+        }
 
-    if (latency_samples > 1) {
-        avg_latency -= min_latency;
-        latency_samples--;
+        // secondary latency threads keep their --lat-secondary-delay in every phase
+        hwcounter_start = lat_tinfo->hwcounter_start = phase_ctl->hwcounter_start + start_delay;
+        hwcounter_stop  = lat_tinfo->hwcounter_stop  = phase_ctl->hwcounter_stop + start_delay;
+
+        printf("CPU%d LATTHREAD%d: phase %d, hwcounter_start = 0x%zx\n", cpu, thread_num, phase, hwcounter_start);
     }
 
-    avg_latency /= latency_samples;
+    perf_close(&lat_tinfo->perf_group);
+    if (lat_tinfo->measure_cpu_freq) {
+        cpu_freq_close(&lat_tinfo->cpu_freq);
+    }
 
-    lat_tinfo->avg_latency = avg_latency;
+    asm volatile ("" : : "r" (p), "r" (heads[0]));  // force p and the chains to be "used"
 }
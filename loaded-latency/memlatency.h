@@ -7,32 +7,68 @@
 #ifndef MEMLATENCY_H
 #define MEMLATENCY_H
 
+#define MAX_LAT_CHAINS 16
+
 struct lat_thread_info {
     pthread_t     thread_id;
-    unsigned long hwcounter_start;
-    unsigned long hwcounter_stop;
+    unsigned long hwcounter_start;  // output: published start, plus start_delay
+    unsigned long hwcounter_stop;   // output: published stop, plus start_delay
+    unsigned long start_delay;      // ticks after the published start and stop, for --lat-secondary-delay
     unsigned long actual_hwcounter_start;   // output
     unsigned long actual_hwcounter_stop;    // output
     int           thread_num;
     int           cpu;              // cpu on which this thread is run
     int           randomize;
+    unsigned long random_seed;      // the loop of thread n is randomized with random_seed, rng stream n
     int           warmup;
     size_t        cacheline_stride;
     int           use_hugepages;
+    int           mem_node;         // NUMA node to bind memory to, or MEM_NODE_NONE
     int           lat_clear_cache;
     size_t        lat_cacheline_bytes;
-    size_t        cacheline_count;
+    size_t        cacheline_count;  // of the first phase, if lat_sizes
+    const size_t * lat_sizes;       // --lat-sizes bytes of the loop of each phase, or NULL
+    size_t        lat_size_count;
     size_t        iterations;
     size_t        lat_offset;
-    double        cycle_time_ns;
+    size_t        chains;           // independent pointer chains followed together
+    double        cycle_time_ns;    // for computing cycles, unless measure_cpu_freq
+    int           measure_cpu_freq; // measure the core frequency of every interval
+    struct cpu_freq cpu_freq;       // output: the --measure-cpu-freq method and base frequency
     double        avg_latency;              // output
+    double        avg_chain_speedup;        // output: see below, if chains > 1
+    double        single_chain_latency;     // output: ns, measured before the start if chains > 1
+
+    /* The chain speedup of an interval is the loads completed per ns by all
+       of the chains, chains / latency, over the loads per ns of one chain
+       followed alone before the start, 1 / single_chain_latency.  It is not
+       the loads in flight: each chain always has one load in flight, so
+       that is chains.  The speedup is lower than chains when the misses of
+       the chains do not overlap, and also when the load on the memory has
+       raised the latency above the single chain latency, so that with
+       bandwidth load it can be below 1. */
+    struct sample_ring ring;                // interim latency samples in ns, to the main thread
+    struct sample_buf samples;              // output: interim latency samples, collected by the main thread
+    struct window_stats window;             // output: samples in the concurrent window, set by the main thread
+    int           finished;                 // output: set when the thread returns (atomic)
+    int           perf;                     // count --perf events per interval
+    struct perf_group perf_group;           // output: the --perf events, opened by the thread
     void **       mem;
+    struct phase_ctl * phase_ctl;           // NULL unless running multiple phases
+    struct start_ctl * start_ctl;           // shared by all threads to start together
+    struct stop_ctl * stop_ctl;             // shared by all threads to stop together
     size_t        lat_cacheline_size;
     char          threadname[32];
 };
 
+void ** lat_alloc(size_t cacheline_bytes, size_t cacheline_count, int use_hugepages, int mem_node);
+
+void lat_link(void ** mem, size_t cacheline_bytes, size_t cacheline_count, int randomize, size_t cacheline_stride,
+        size_t chains, const cpu_set_t * init_cpus, unsigned long seed, size_t stream);
+
 void ** lat_initialize(size_t cacheline_bytes,
-        size_t cacheline_count, int randomize, int clear_cache, size_t cachline_stride, int use_hugepages);
+        size_t cacheline_count, int randomize, int clear_cache, size_t cachline_stride, int use_hugepages, int mem_node,
+        size_t chains, const cpu_set_t * init_cpus, unsigned long seed, size_t stream);
 
 void latency_thread (struct lat_thread_info * lat_tinfo);
 
@@ -0,0 +1,511 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#ifdef __aarch64__
+#include "cntvct.h"
+#endif
+
+#ifdef __x86_64__
+#include "rdtsc.h"
+#endif
+
+#include "args.h"
+#include "alloc.h"
+#include "stats.h"
+#include "perf.h"
+#include "cpufreq.h"
+#include "bwkernels.h"
+#include "bandwidth.h"
+#include "memlatency.h"
+#include "c2c.h"
+#include "output.h"
+
+/*
+ * JSON is written as one object:
+ *
+ *   { "config": { name: value, ... },
+ *     "threads": [ { "type": "bandwidth" or "latency", ..., "samples": [ ... ] }, ... ],
+ *     "summary": { ... },
+ *     "c2c": { "mode": ..., "cpuA_cpuB_ns": one-way latency, ... },
+ *     "concurrency": { ... } }
+ *
+ * CSV is written as one table in which each row is one value:
+ *
+ *   record,thread,cpu,name,start_tick,stop_tick,time,value
+ *
+ * where record is config, sample, thread, summary, c2c or concurrency, and the
+ * columns that do not apply to a record are empty.
+ */
+
+struct out {
+    FILE *  f;
+    int     format;
+    int     first;          // JSON: no comma needed before the next member
+    const char * record;    // CSV: record column of the rows being written
+    const char * thread;    // CSV: thread column, e.g. "bw0"
+    int     cpu;            // CSV: cpu column, or -1
+};
+
+static void out_name(struct out * o, const char * name) {
+    if (o->format == OUTPUT_JSON) {
+        fprintf(o->f, "%s\n    \"%s\": ", o->first ? "" : ",", name);
+        o->first = 0;
+    } else {
+        fprintf(o->f, "%s,%s,", o->record, o->thread);
+        if (o->cpu >= 0) {
+            fprintf(o->f, "%d", o->cpu);
+        }
+        fprintf(o->f, ",%s,,,,", name);
+    }
+}
+
+static void out_string(struct out * o, const char * name, const char * value) {
+    out_name(o, name);
+    if (o->format == OUTPUT_JSON) {
+        fprintf(o->f, "\"%s\"", value);
+    } else {
+        fprintf(o->f, "\"%s\"\n", value);
+    }
+}
+
+static void out_ulong(struct out * o, const char * name, unsigned long value) {
+    out_name(o, name);
+    fprintf(o->f, o->format == OUTPUT_JSON ? "%lu" : "%lu\n", value);
+}
+
+static void out_long(struct out * o, const char * name, long value) {
+    out_name(o, name);
+    fprintf(o->f, o->format == OUTPUT_JSON ? "%ld" : "%ld\n", value);
+}
+
+static void out_double(struct out * o, const char * name, double value) {
+    out_name(o, name);
+    if (o->format == OUTPUT_JSON && ! isfinite(value)) {
+        fprintf(o->f, "null");      // JSON has no NaN or infinity
+    } else {
+        fprintf(o->f, o->format == OUTPUT_JSON ? "%.9g" : "%.9g\n", value);
+    }
+}
+
+static void out_cpuset(struct out * o, const char * name, const cpu_set_t * cpuset) {
+    char buf[8 * CPU_SETSIZE] = "";
+    size_t len = 0;
+
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, cpuset)) {
+            len += snprintf(buf + len, sizeof(buf) - len, "%s%d", len ? " " : "", i);
+        }
+    }
+
+    out_string(o, name, buf);
+}
+
+static void out_int_list(struct out * o, const char * name, const int * values, size_t count) {
+    char buf[8 * CPU_SETSIZE] = "";
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%d", i ? " " : "", values[i]);
+    }
+
+    out_string(o, name, buf);
+}
+
+static void out_size_list(struct out * o, const char * name, const size_t * values, size_t count) {
+    char buf[24 * MAX_SWEEP_STEPS] = "";
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%zu", i ? " " : "", values[i]);
+    }
+
+    out_string(o, name, buf);
+}
+
+// JSON objects are indented by one level only, so that each sample is one line
+
+static void out_begin(struct out * o, const char * name, const char * open) {
+    if (o->format == OUTPUT_JSON) {
+        if (name) {
+            fprintf(o->f, "%s\n  \"%s\": %s", o->first ? "" : ",", name, open);
+        } else {
+            fprintf(o->f, "%s\n  %s", o->first ? "" : ",", open);
+        }
+        o->first = 1;
+    }
+}
+
+static void out_end(struct out * o, const char * close) {
+    if (o->format == OUTPUT_JSON) {
+        fprintf(o->f, "\n  %s", close);
+        o->first = 0;
+    }
+}
+
+static void out_config(struct out * o, const args_t * args) {
+    o->record = "config";
+    o->thread = "";
+    o->cpu = -1;
+
+    out_begin(o, "config", "{");
+    out_double(o, "duration", args->duration);
+    out_double(o, "delay_seconds", args->delay_seconds);
+    out_ulong(o, "delay_ticks", args->delay_ticks);
+    out_ulong(o, "hwclock_freq", args->hwclock_freq);
+    out_long(o, "random_seedval", args->random_seedval);
+    out_double(o, "cycle_time_ns", args->cycle_time_ns);
+    out_double(o, "mhz", args->mhz);
+    out_long(o, "measure_cpu_freq", args->measure_cpu_freq);
+    out_long(o, "ssbs", args->ssbs);
+    out_long(o, "perf", args->perf);
+
+    out_cpuset(o, "lat_cpus", &args->lat_cpuset);
+    out_cpuset(o, "lat_warmup_cpus", &args->lat_warmup_cpuset);
+    out_ulong(o, "lat_cacheline_count", args->lat_cacheline_count);
+    out_ulong(o, "lat_cacheline_bytes", args->lat_cacheline_bytes);
+    out_ulong(o, "lat_cacheline_stride", args->lat_cacheline_stride);
+    out_ulong(o, "lat_iterations", args->lat_iterations);
+    out_ulong(o, "lat_offset", args->lat_offset);
+    out_ulong(o, "lat_secondary_delay", args->lat_secondary_delay);
+    out_long(o, "lat_randomize", args->lat_randomize);
+    out_string(o, "lat_use_hugepages", hugepage_map(args->lat_use_hugepages));
+    out_long(o, "lat_shared_memory", args->lat_shared_memory);
+    out_long(o, "lat_shared_memory_init_cpu", args->lat_shared_memory_init_cpu);
+    out_long(o, "lat_clear_cache", args->lat_clear_cache);
+    out_int_list(o, "lat_mem_nodes", args->lat_mem_nodes, args->lat_mem_node_count);
+    out_ulong(o, "lat_chains", args->lat_chains);
+
+    out_cpuset(o, "bw_cpus", &args->bw_cpuset);
+    out_ulong(o, "bw_buflen", args->bw_buflen);
+    out_ulong(o, "bw_iterations", args->bw_iterations);
+    out_ulong(o, "bw_fine_delay", args->bw_inner_nops);
+    out_ulong(o, "bw_coarse_delay", args->bw_outer_nops);
+    out_ulong(o, "bw_cacheline_bytes", args->bw_cacheline_bytes);
+    out_string(o, "bw_use_hugepages", hugepage_map(args->bw_use_hugepages));
+    out_long(o, "bw_write", args->bw_write);
+    out_string(o, "bw_write_mode", bw_write_mode_map(args->bw_write_mode));
+    out_string(o, "bw_kernel", bw_kernel_map(args->bw_kernel));
+    out_ulong(o, "bw_prefetch_lines", args->bw_prefetch_lines);
+    out_string(o, "bw_kind", bw_kind_map(args->bw_kind));
+    out_string(o, "bw_atomic_op", bw_atomic_op_map(args->bw_atomic_op));
+    out_ulong(o, "bw_atomic_lines", args->bw_atomic_lines);
+    out_string(o, "bw_pattern", bw_pattern_map(args->bw_pattern));
+    out_ulong(o, "bw_stride_bytes", args->bw_stride_bytes);
+    out_double(o, "bw_target_mbps", args->bw_target_mbps);
+    out_long(o, "bw_target_per_thread", args->bw_target_per_thread);
+    out_int_list(o, "bw_mem_nodes", args->bw_mem_nodes, args->bw_mem_node_count);
+
+    out_size_list(o, "sweep_fine_delays", args->sweep_fine_delays, args->sweep_fine_delay_count);
+    out_size_list(o, "lat_sizes", args->lat_sizes, args->lat_size_count);
+    out_ulong(o, "bw_ramp_step", args->bw_ramp_step);
+    out_cpuset(o, "c2c_cpus", &args->c2c_cpuset);
+    out_end(o, "}");
+}
+
+// the --measure-cpu-freq frequency and the --perf event counts of each sample follow its value
+
+static void out_samples(struct out * o, const struct sample_buf * buf, const struct perf_group * group,
+        unsigned long hwcounter_start, const char * name, double scale) {
+    double cntfreq = (double) read_cntfreq();
+
+    if (o->format == OUTPUT_JSON) {
+        fprintf(o->f, ",\n    \"samples\": [");
+        for (size_t i = 0; i < buf->count; i++) {
+            const struct sample * s = &buf->samples[i];
+            fprintf(o->f, "%s\n      { \"start_tick\": %lu, \"stop_tick\": %lu, \"time\": %.9f, \"%s\": %.9g",
+                    i ? "," : "", s->start_tick, s->stop_tick,
+                    ((long) (s->start_tick - hwcounter_start)) / cntfreq, name, s->value * scale);
+            if (s->core_mhz > 0) {
+                fprintf(o->f, ", \"core_mhz\": %.9g", s->core_mhz);
+            }
+            for (int k = 0; k < group->count; k++) {
+                fprintf(o->f, ", \"%s\": %lu", group->names[k], s->counts[k]);
+            }
+            fprintf(o->f, " }");
+        }
+        fprintf(o->f, "\n    ]");
+    } else {
+        for (size_t i = 0; i < buf->count; i++) {
+            const struct sample * s = &buf->samples[i];
+            double time = ((long) (s->start_tick - hwcounter_start)) / cntfreq;
+
+            fprintf(o->f, "sample,%s,%d,%s,%lu,%lu,%.9f,%.9g\n", o->thread, o->cpu, name,
+                    s->start_tick, s->stop_tick, time, s->value * scale);
+            if (s->core_mhz > 0) {
+                fprintf(o->f, "sample,%s,%d,core_mhz,%lu,%lu,%.9f,%.9g\n", o->thread, o->cpu,
+                        s->start_tick, s->stop_tick, time, s->core_mhz);
+            }
+            for (int k = 0; k < group->count; k++) {
+                fprintf(o->f, "sample,%s,%d,%s,%lu,%lu,%.9f,%lu\n", o->thread, o->cpu, group->names[k],
+                        s->start_tick, s->stop_tick, time, s->counts[k]);
+            }
+        }
+    }
+}
+
+static void out_stats(struct out * o, const struct sample_buf * buf, const char * name, double scale) {
+    struct sample_stats stats;
+    char stat_name[64];
+
+    compute_sample_stats(buf->samples, buf->count, &stats);
+
+    const struct {
+        const char * suffix;
+        double value;
+    } values[] = {
+        { "mean", stats.mean }, { "stddev", stats.stddev }, { "ci95", stats.ci95 },
+        { "min", stats.min }, { "p50", stats.p50 }, { "p90", stats.p90 },
+        { "p99", stats.p99 }, { "max", stats.max },
+    };
+
+    out_ulong(o, "sample_count", stats.count);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        snprintf(stat_name, sizeof(stat_name), "%s_%s", name, values[i].suffix);
+        out_double(o, stat_name, values[i].value * scale);
+    }
+}
+
+static void out_threads(struct out * o, unsigned long hwcounter_start,
+        const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+    char thread[32];
+
+    o->record = "thread";
+    o->thread = thread;
+
+    out_begin(o, "threads", "[");
+
+    for (int i = 0; i < num_bw_threads; i++) {
+        snprintf(thread, sizeof(thread), "bw%d", bw_tinfo[i].thread_num);
+        o->cpu = bw_tinfo[i].cpu;
+
+        out_begin(o, NULL, "{");
+        out_string(o, "type", "bandwidth");
+        out_long(o, "thread_num", bw_tinfo[i].thread_num);
+        out_long(o, "cpu", bw_tinfo[i].cpu);
+        out_long(o, "mem_node", bw_tinfo[i].mem_node);
+        out_string(o, "bw_kind", bw_kind_map(bw_tinfo[i].bw_kind));
+        out_ulong(o, "bw_buflen", bw_tinfo[i].bw_buflen);
+        out_ulong(o, "inner_nops", bw_tinfo[i].inner_nops);
+        out_ulong(o, "outer_nops", bw_tinfo[i].outer_nops);
+        out_ulong(o, "iterations", bw_tinfo[i].iterations);
+        out_ulong(o, "hwcounter_start", bw_tinfo[i].hwcounter_start);
+        out_ulong(o, "hwcounter_stop", bw_tinfo[i].hwcounter_stop);
+        out_ulong(o, "actual_hwcounter_start", bw_tinfo[i].actual_hwcounter_start);
+        out_ulong(o, "actual_hwcounter_stop", bw_tinfo[i].actual_hwcounter_stop);
+        out_double(o, "avg_bandwidth_mbps", bw_tinfo[i].avg_bw / 1e6);
+        out_double(o, "concurrent_bandwidth_mbps", bw_tinfo[i].window.mean / 1e6);
+        if (bw_tinfo[i].bw_kind == BW_KIND_ATOMIC) {
+            out_double(o, "concurrent_atomic_mops", bw_tinfo[i].window.mean / bw_tinfo[i].bw_cacheline_bytes / 1e6);
+        } else {
+            if (bw_tinfo[i].bw_pattern != BW_PATTERN_SEQUENTIAL) {
+                out_double(o, bw_pattern_updates(&bw_tinfo[i], 1) ? "concurrent_mupdates" : "concurrent_maccesses",
+                           bw_tinfo[i].window.mean / bw_tinfo[i].bw_cacheline_bytes / 1e6);
+            }
+            int streams = bw_tinfo[i].read_streams + bw_tinfo[i].write_streams;
+            out_double(o, "concurrent_read_mbps", bw_tinfo[i].window.mean * bw_tinfo[i].read_streams / streams / 1e6);
+            out_double(o, "concurrent_write_mbps", bw_tinfo[i].window.mean * bw_tinfo[i].write_streams / streams / 1e6);
+        }
+        out_ulong(o, "concurrent_samples", bw_tinfo[i].window.kept);
+        out_ulong(o, "discarded_samples", bw_tinfo[i].window.discarded);
+        out_stats(o, &bw_tinfo[i].samples, "bandwidth_mbps", 1e-6);
+        out_samples(o, &bw_tinfo[i].samples, &bw_tinfo[i].perf_group, hwcounter_start, "bandwidth_mbps", 1e-6);
+        out_end(o, "}");
+    }
+
+    for (int i = 0; i < num_lat_threads; i++) {
+        snprintf(thread, sizeof(thread), "lat%d", lat_tinfo[i].thread_num);
+        o->cpu = lat_tinfo[i].cpu;
+
+        out_begin(o, NULL, "{");
+        out_string(o, "type", "latency");
+        out_long(o, "thread_num", lat_tinfo[i].thread_num);
+        out_long(o, "cpu", lat_tinfo[i].cpu);
+        out_long(o, "mem_node", lat_tinfo[i].mem_node);
+        out_ulong(o, "cacheline_count", lat_tinfo[i].cacheline_count);
+        out_ulong(o, "cacheline_stride", lat_tinfo[i].cacheline_stride);
+        out_ulong(o, "hwcounter_start", lat_tinfo[i].hwcounter_start);
+        out_ulong(o, "hwcounter_stop", lat_tinfo[i].hwcounter_stop);
+        out_ulong(o, "actual_hwcounter_start", lat_tinfo[i].actual_hwcounter_start);
+        out_ulong(o, "actual_hwcounter_stop", lat_tinfo[i].actual_hwcounter_stop);
+        out_double(o, "avg_latency_ns", lat_tinfo[i].avg_latency);
+        out_double(o, "concurrent_latency_ns", lat_tinfo[i].window.mean);
+        out_ulong(o, "concurrent_samples", lat_tinfo[i].window.kept);
+        out_ulong(o, "discarded_samples", lat_tinfo[i].window.discarded);
+        if (lat_tinfo[i].chains > 1) {
+            out_double(o, "avg_chain_speedup", lat_tinfo[i].avg_chain_speedup);
+        }
+        if (lat_tinfo[i].measure_cpu_freq) {
+            struct cpu_freq_stats freq_stats;
+            compute_cpu_freq_stats(&lat_tinfo[i].cpu_freq, lat_tinfo[i].samples.samples, lat_tinfo[i].samples.count, &freq_stats);
+            out_string(o, "cpu_freq_method", cpu_freq_method_map(lat_tinfo[i].cpu_freq.method));
+            out_double(o, "base_core_mhz", lat_tinfo[i].cpu_freq.base_mhz);
+            out_double(o, "mean_core_mhz", freq_stats.mean_mhz);
+            out_double(o, "min_core_mhz", freq_stats.min_mhz);
+            out_ulong(o, "core_freq_drops", freq_stats.drops);
+            out_double(o, "latency_cycles_mean", freq_stats.mean_cycles);
+        }
+        out_stats(o, &lat_tinfo[i].samples, "latency_ns", 1.0);
+        out_samples(o, &lat_tinfo[i].samples, &lat_tinfo[i].perf_group, hwcounter_start, "latency_ns", 1.0);
+        out_end(o, "}");
+    }
+
+    out_end(o, "]");
+}
+
+static void out_summary(struct out * o,
+        const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads) {
+    double total_bw = 0.0, avg_latency = 0.0;
+    double unwindowed_bw = 0.0, unwindowed_latency = 0.0;
+    double read_bw = 0.0, write_bw = 0.0;
+
+    // the totals are over the concurrent window, as printed by main()
+    for (int i = 0; i < num_bw_threads; i++) {
+        int streams = bw_tinfo[i].read_streams + bw_tinfo[i].write_streams;
+
+        total_bw += bw_tinfo[i].window.mean;
+        unwindowed_bw += bw_tinfo[i].avg_bw;
+        read_bw += bw_tinfo[i].window.mean * bw_tinfo[i].read_streams / streams;
+        write_bw += bw_tinfo[i].window.mean * bw_tinfo[i].write_streams / streams;
+    }
+    for (int i = 0; i < num_lat_threads; i++) {
+        avg_latency += lat_tinfo[i].window.mean;
+        unwindowed_latency += lat_tinfo[i].avg_latency;
+    }
+
+    o->record = "summary";
+    o->thread = "";
+    o->cpu = -1;
+
+    out_begin(o, "summary", "{");
+    out_double(o, "total_bandwidth_mbps", total_bw / 1e6);
+    if (num_bw_threads && bw_tinfo[0].bw_kind == BW_KIND_ATOMIC) {
+        out_double(o, "total_atomic_mops", total_bw / bw_tinfo[0].bw_cacheline_bytes / 1e6);
+    } else if (num_bw_threads) {
+        if (bw_tinfo[0].bw_pattern != BW_PATTERN_SEQUENTIAL) {
+            out_double(o, bw_pattern_updates(bw_tinfo, num_bw_threads) ? "total_mupdates" : "total_maccesses",
+                       total_bw / bw_tinfo[0].bw_cacheline_bytes / 1e6);
+        }
+        out_double(o, "total_read_mbps", read_bw / 1e6);
+        out_double(o, "total_write_mbps", write_bw / 1e6);
+    }
+    out_double(o, "average_latency_ns", num_lat_threads ? avg_latency / num_lat_threads : 0.0);
+    out_double(o, "unwindowed_bandwidth_mbps", unwindowed_bw / 1e6);
+    out_double(o, "unwindowed_latency_ns", num_lat_threads ? unwindowed_latency / num_lat_threads : 0.0);
+    out_end(o, "}");
+}
+
+// the pairs left unmeasured by the stop are left out
+
+static void out_c2c(struct out * o, const struct c2c_ctl * c2c_ctl, const struct c2c_thread_info * c2c_tinfo) {
+    int n = c2c_ctl->num_threads;
+    char name[64];
+
+    o->record = "c2c";
+    o->thread = "";
+    o->cpu = -1;
+
+    out_begin(o, "c2c", "{");
+    out_string(o, "mode", c2c_mode_map(c2c_ctl->mode));
+    out_ulong(o, "iterations", c2c_ctl->iterations);
+    for (int a = 0; a < n; a++) {
+        for (int b = a + 1; b < n; b++) {
+            if (c2c_ctl->latency[a * n + b] > 0) {
+                snprintf(name, sizeof(name), "cpu%d_cpu%d_ns", c2c_tinfo[a].cpu, c2c_tinfo[b].cpu);
+                out_double(o, name, c2c_ctl->latency[a * n + b]);
+            }
+        }
+    }
+    out_end(o, "}");
+}
+
+static void out_concurrency(struct out * o, const struct concurrency_metrics * m) {
+    double cntfreq = (double) read_cntfreq();
+    int have_bw = m->bw_hwcounter_start_max != 0;
+    int have_lat = m->lat_hwcounter_start_max != 0;
+
+    o->record = "concurrency";
+
+    out_begin(o, "concurrency", "{");
+    if (have_bw) {
+        out_ulong(o, "bw_hwcounter_start_min", m->bw_hwcounter_start_min);
+        out_ulong(o, "bw_hwcounter_start_max", m->bw_hwcounter_start_max);
+        out_ulong(o, "bw_hwcounter_stop_min", m->bw_hwcounter_stop_min);
+        out_ulong(o, "bw_hwcounter_stop_max", m->bw_hwcounter_stop_max);
+        out_double(o, "bw_start_spread_seconds", (m->bw_hwcounter_start_max - m->bw_hwcounter_start_min) / cntfreq);
+        out_double(o, "bw_stop_spread_seconds", (m->bw_hwcounter_stop_max - m->bw_hwcounter_stop_min) / cntfreq);
+    }
+    if (have_lat) {
+        out_ulong(o, "lat_hwcounter_start_min", m->lat_hwcounter_start_min);
+        out_ulong(o, "lat_hwcounter_start_max", m->lat_hwcounter_start_max);
+        out_ulong(o, "lat_hwcounter_stop_min", m->lat_hwcounter_stop_min);
+        out_ulong(o, "lat_hwcounter_stop_max", m->lat_hwcounter_stop_max);
+        out_double(o, "lat_start_spread_seconds", (m->lat_hwcounter_start_max - m->lat_hwcounter_start_min) / cntfreq);
+        out_double(o, "lat_stop_spread_seconds", (m->lat_hwcounter_stop_max - m->lat_hwcounter_stop_min) / cntfreq);
+    }
+    if (m->window_stop > m->window_start) {
+        out_ulong(o, "window_start", m->window_start);
+        out_ulong(o, "window_stop", m->window_stop);
+        out_double(o, "window_seconds", (m->window_stop - m->window_start) / cntfreq);
+    }
+    if (have_bw && have_lat) {
+        out_double(o, "bw_lat_start_spread_seconds", (long) (m->bw_hwcounter_start_min - m->lat_hwcounter_start_min) / cntfreq);
+        out_double(o, "bw_lat_stop_spread_seconds", (long) (m->bw_hwcounter_stop_min - m->lat_hwcounter_stop_min) / cntfreq);
+    }
+    out_end(o, "}");
+}
+
+void write_results(const args_t * args, unsigned long hwcounter_start,
+        const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads,
+        const struct c2c_ctl * c2c_ctl, const struct c2c_thread_info * c2c_tinfo,
+        const struct concurrency_metrics * metrics) {
+
+    struct out o = {
+        .format = args->output_format,
+        .first = 1,
+    };
+
+    o.f = fopen(args->output_file, "w");
+    if (o.f == NULL) {
+        printf("ERROR: could not open --output-file %s: %s\n", args->output_file, strerror(errno));
+        exit(-1);
+    }
+
+    if (o.format == OUTPUT_JSON) {
+        fprintf(o.f, "{");
+    } else {
+        fprintf(o.f, "record,thread,cpu,name,start_tick,stop_tick,time,value\n");
+    }
+
+    out_config(&o, args);
+    out_threads(&o, hwcounter_start, bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+    out_summary(&o, bw_tinfo, num_bw_threads, lat_tinfo, num_lat_threads);
+    if (c2c_ctl) {
+        out_c2c(&o, c2c_ctl, c2c_tinfo);
+    }
+    out_concurrency(&o, metrics);
+
+    if (o.format == OUTPUT_JSON) {
+        fprintf(o.f, "\n}\n");
+    }
+
+    if (fclose(o.f)) {
+        printf("ERROR: could not write --output-file %s: %s\n", args->output_file, strerror(errno));
+        exit(-1);
+    }
+
+    printf("results written to %s\n", args->output_file);
+}
@@ -0,0 +1,47 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+enum {
+    OUTPUT_NONE,
+    OUTPUT_JSON,
+    OUTPUT_CSV,
+    OUTPUT_MAX_ENUM
+};
+
+// actual start and stop hwcounter ranges of the threads, from main()
+struct concurrency_metrics {
+    unsigned long bw_hwcounter_start_min;
+    unsigned long bw_hwcounter_start_max;
+    unsigned long bw_hwcounter_stop_min;
+    unsigned long bw_hwcounter_stop_max;
+    unsigned long lat_hwcounter_start_min;
+    unsigned long lat_hwcounter_start_max;
+    unsigned long lat_hwcounter_stop_min;
+    unsigned long lat_hwcounter_stop_max;
+    unsigned long window_start;     // concurrent window; both 0 if the threads did not overlap
+    unsigned long window_stop;
+};
+
+struct bw_thread_info;
+struct lat_thread_info;
+struct c2c_ctl;
+struct c2c_thread_info;
+
+/* write_results() writes the configuration, the samples and averages of
+   every thread, the core-to-core latency matrix if c2c_ctl is not NULL, and
+   the concurrency metrics to args->output_file.  Sample times are in
+   seconds from hwcounter_start. */
+
+void write_results(const args_t * args, unsigned long hwcounter_start,
+        const struct bw_thread_info * bw_tinfo, int num_bw_threads,
+        const struct lat_thread_info * lat_tinfo, int num_lat_threads,
+        const struct c2c_ctl * c2c_ctl, const struct c2c_thread_info * c2c_tinfo,
+        const struct concurrency_metrics * metrics);
+
+#endif
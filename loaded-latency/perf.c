@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "stats.h"
+#include "perf.h"
+
+#define CACHE_EVENT(cache, result) \
+        ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+static const struct perf_event_spec {
+    const char * name;
+    __u32        type;
+    __u64        config;
+} hardware_events[] = {
+    // the first event is the group leader; without it, software_events are used
+    { "cycles",         PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "l1d_misses",     PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "llc_misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "dtlb_misses",    PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "stalled_cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND },
+}, software_events[] = {
+    { "task_clock_ns",  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page_faults",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+static int open_event(const struct perf_event_spec * spec, int group_fd) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec->type;
+    attr.config = spec->config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_hv = 1;
+
+    // hardware events count only this program, which is allowed at the default
+    // perf_event_paranoid.  Page faults and context switches happen in the
+    // kernel, so software events include it if allowed.
+    attr.exclude_kernel = spec->type != PERF_TYPE_SOFTWARE;
+
+    // pid 0 and cpu -1 count the calling thread on whichever CPU it runs
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+
+    if (fd < 0 && (errno == EACCES || errno == EPERM) && ! attr.exclude_kernel) {
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+
+    return fd;
+}
+
+static void open_events(struct perf_group * group, const struct perf_event_spec * specs, size_t num_specs) {
+    for (size_t i = 0; i < num_specs && group->count < SAMPLE_MAX_COUNTERS; i++) {
+        int fd = open_event(&specs[i], group->count ? group->fds[0] : -1);
+
+        if (fd < 0) {
+            if (group->count == 0) {
+                return;     // no leader, so no group
+            }
+            continue;       // leave out an event that this CPU does not have
+        }
+
+        group->fds[group->count] = fd;
+        group->names[group->count] = specs[i].name;
+        group->count++;
+    }
+}
+
+void perf_open(struct perf_group * group, const char * label) {
+    memset(group, 0, sizeof(*group));
+
+    open_events(group, hardware_events, sizeof(hardware_events) / sizeof(hardware_events[0]));
+
+    if (group->count == 0) {
+        group->software = 1;
+        open_events(group, software_events, sizeof(software_events) / sizeof(software_events[0]));
+    }
+
+    if (group->count == 0) {
+        printf("%s: --perf could not open any event: %s\n", label, strerror(errno));
+        return;
+    }
+
+    printf("%s: perf %s events =", label, group->software ? "software" : "hardware");
+    for (int i = 0; i < group->count; i++) {
+        printf(" %s", group->names[i]);
+    }
+    printf("\n");
+}
+
+int perf_open_cycles(void) {
+    return open_event(&hardware_events[0], -1);
+}
+
+unsigned long perf_read_cycles(int fd) {
+    __u64 buf[4];       // nr, time_enabled, time_running, cycles
+
+    if (read(fd, buf, sizeof(buf)) < (ssize_t) sizeof(buf)) {
+        printf("ERROR: read of perf cycles failed: %s\n", strerror(errno));
+        exit(-1);
+    }
+
+    if (buf[2] < buf[1] && buf[2] > 0) {
+        return buf[3] * (buf[1] / (double) buf[2]);
+    }
+    return buf[3];
+}
+
+static void read_group(const struct perf_group * group, unsigned long * counts, unsigned long * enabled, unsigned long * running) {
+    __u64 buf[3 + SAMPLE_MAX_COUNTERS];    // nr, time_enabled, time_running, then the values
+
+    if (read(group->fds[0], buf, sizeof(buf)) < (ssize_t) ((3 + group->count) * sizeof(__u64))) {
+        printf("ERROR: read of perf group failed: %s\n", strerror(errno));
+        exit(-1);
+    }
+
+    *enabled = buf[1];
+    *running = buf[2];
+    for (int i = 0; i < group->count; i++) {
+        counts[i] = buf[3 + i];
+    }
+}
+
+void perf_start(struct perf_group * group) {
+    if (group->count == 0) {
+        return;
+    }
+
+    read_group(group, group->start, &group->start_enabled, &group->start_running);
+}
+
+void perf_stop(struct perf_group * group, unsigned long * counts) {
+    unsigned long stop[SAMPLE_MAX_COUNTERS];
+    unsigned long enabled, running;
+
+    memset(counts, 0, SAMPLE_MAX_COUNTERS * sizeof(unsigned long));
+
+    if (group->count == 0) {
+        return;
+    }
+
+    read_group(group, stop, &enabled, &running);
+
+    // if the group shared the PMU with other events, estimate the counts for all of the interval
+    double scale = 1.0;
+    if (running - group->start_running < enabled - group->start_enabled && running > group->start_running) {
+        scale = (enabled - group->start_enabled) / (double) (running - group->start_running);
+    }
+
+    for (int i = 0; i < group->count; i++) {
+        counts[i] = (stop[i] - group->start[i]) * scale;
+    }
+}
+
+void perf_close(struct perf_group * group) {
+    for (int i = 0; i < group->count; i++) {
+        close(group->fds[i]);
+        group->fds[i] = -1;
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+/*
+ * --perf counts PMU events in each measurement thread with a perf_event_open
+ * group, which is read at the start and the end of every interval, outside of
+ * the hwcounter timing.  Events that the kernel or the CPU do not support are
+ * left out of the group.  If no hardware event can be opened, e.g. in a VM
+ * without a virtual PMU, software events are counted instead.
+ *
+ * perf.h uses SAMPLE_MAX_COUNTERS from stats.h.
+ */
+
+struct perf_group {
+    int           fds[SAMPLE_MAX_COUNTERS];     // fds[0] is the group leader
+    const char *  names[SAMPLE_MAX_COUNTERS];
+    int           count;            // events in the group; 0 if none could be opened
+    int           software;         // 1 if the group is of software events
+    unsigned long start[SAMPLE_MAX_COUNTERS];   // counts at perf_start()
+    unsigned long start_enabled;    // group time enabled at perf_start()
+    unsigned long start_running;    // group time running at perf_start()
+};
+
+// opens the group for the calling thread and prints the events, prefixed by label
+void perf_open(struct perf_group * group, const char * label);
+
+// reads the counts at the start of an interval
+void perf_start(struct perf_group * group);
+
+// reads the counts at the end of an interval and stores the counts of the interval,
+// scaled up if the group was multiplexed with other events
+void perf_stop(struct perf_group * group, unsigned long * counts);
+
+// closes the events of the group when the thread exits; the names and count stay for printing
+void perf_close(struct perf_group * group);
+
+// opens a user-mode core cycle counter of the calling thread alone, or returns -1
+int perf_open_cycles(void);
+
+// reads a counter opened by perf_open_cycles(), scaled up if it was multiplexed
+unsigned long perf_read_cycles(int fd);
+
+#endif
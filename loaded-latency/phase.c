@@ -0,0 +1,107 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+
+#include "phase.h"
+
+void start_ready(struct start_ctl * ctl) {
+
+    __atomic_add_fetch(&ctl->threads_ready, 1, __ATOMIC_RELEASE);
+
+    // spin instead of sleeping; this CPU is dedicated to the thread anyway
+    while (! __atomic_load_n(&ctl->published, __ATOMIC_ACQUIRE)) {
+        ;
+    }
+}
+
+void start_wait_ready(struct start_ctl * ctl, int num_threads) {
+    const struct timespec poll_interval = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    // the main thread is not pinned, so sleep to stay out of the way of the workers
+    while (__atomic_load_n(&ctl->threads_ready, __ATOMIC_ACQUIRE) < num_threads) {
+        nanosleep(&poll_interval, NULL);
+    }
+}
+
+void start_publish(struct start_ctl * ctl, unsigned long hwcounter_start, unsigned long hwcounter_stop) {
+    ctl->hwcounter_start = hwcounter_start;
+    ctl->hwcounter_stop = hwcounter_stop;
+
+    __atomic_store_n(&ctl->published, 1, __ATOMIC_RELEASE);
+}
+
+int stop_check(struct stop_ctl * ctl, unsigned long hwcounter, unsigned long hwcounter_stop) {
+
+    // the flag is only written once per phase, so polling it stays in this core's cache
+    if (__atomic_load_n(&ctl->stop, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+
+    if (hwcounter >= hwcounter_stop) {
+        __atomic_store_n(&ctl->stop, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    return 0;
+}
+
+void stop_arrive(struct stop_ctl * ctl) {
+    // a thread may stop on its own hwcounter_stop before seeing the flag
+    __atomic_store_n(&ctl->stop, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&ctl->threads_stopped, 1, __ATOMIC_RELEASE);
+}
+
+int stop_draining(struct stop_ctl * ctl) {
+    return __atomic_load_n(&ctl->threads_stopped, __ATOMIC_ACQUIRE) < ctl->num_threads;
+}
+
+void stop_reset(struct stop_ctl * ctl) {
+    ctl->stop = 0;
+    ctl->threads_stopped = 0;
+}
+
+int phase_wait_next(struct phase_ctl * ctl, int * phase) {
+
+    __atomic_add_fetch(&ctl->threads_finished, 1, __ATOMIC_RELEASE);
+
+    // spin instead of sleeping; this CPU is dedicated to the thread anyway
+    while (__atomic_load_n(&ctl->phase, __ATOMIC_ACQUIRE) == *phase) {
+        if (__atomic_load_n(&ctl->done, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+    }
+
+    (*phase)++;
+
+    return 1;
+}
+
+void phase_wait_finished(struct phase_ctl * ctl, int num_threads, void (*poll)(void *), void * poll_arg) {
+    const struct timespec poll_interval = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    // the main thread is not pinned, so sleep to stay out of the way of the workers
+    while (__atomic_load_n(&ctl->threads_finished, __ATOMIC_ACQUIRE) < num_threads) {
+        if (poll) {
+            poll(poll_arg);
+        }
+        nanosleep(&poll_interval, NULL);
+    }
+
+    ctl->threads_finished = 0;
+}
+
+void phase_publish(struct phase_ctl * ctl, unsigned long hwcounter_start, unsigned long hwcounter_stop) {
+    ctl->hwcounter_start = hwcounter_start;
+    ctl->hwcounter_stop = hwcounter_stop;
+    __atomic_add_fetch(&ctl->phase, 1, __ATOMIC_RELEASE);
+}
+
+void phase_end(struct phase_ctl * ctl) {
+    __atomic_store_n(&ctl->done, 1, __ATOMIC_RELEASE);
+}
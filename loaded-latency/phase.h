@@ -0,0 +1,98 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef PHASE_H
+#define PHASE_H
+
+#include <stddef.h>
+
+/*
+ * A phase is one synchronized measurement window of all the threads.
+ * Multi-phase modes (e.g. --sweep-fine-delay) keep the threads and their
+ * memory alive between phases.  After a thread finishes a phase, it waits
+ * for the main thread to publish the hwcounter start and stop of the next
+ * phase along with the parameters that change between phases.
+ */
+
+#define PHASE_START_MARGIN_SECONDS 0.01   // time from publishing a phase to its start
+
+/*
+ * A start_ctl starts the first phase once every thread is ready, instead of
+ * at a guessed delay after the threads are created.  Each thread signals that
+ * it is ready after it has allocated and initialized its memory, and then
+ * waits for the main thread to publish the hwcounter start and stop, which
+ * are a --delay-seconds margin after the last thread became ready.
+ */
+
+struct start_ctl {
+    int                    threads_ready;    // threads done with their setup (atomic)
+    int                    published;        // 1 once hwcounter_start and hwcounter_stop are set (atomic)
+    unsigned long          hwcounter_start;
+    unsigned long          hwcounter_stop;
+};
+
+// called by a worker thread after its setup.  Returns once the start is published.
+void start_ready(struct start_ctl * ctl);
+
+// called by the main thread to wait for num_threads to be ready
+void start_wait_ready(struct start_ctl * ctl, int num_threads);
+
+// called by the main thread to start the first phase
+void start_publish(struct start_ctl * ctl, unsigned long hwcounter_start, unsigned long hwcounter_stop);
+
+struct phase_ctl {
+    volatile int           phase;            // number of the most recently published phase
+    volatile int           done;             // 1 when no more phases will be published
+    volatile unsigned long hwcounter_start;  // start of the published phase
+    volatile unsigned long hwcounter_stop;   // stop of the published phase
+    volatile size_t        bw_inner_nops;    // bandwidth fine delay for the published phase
+    volatile int           bw_active_threads; // bandwidth threads that measure in the published phase
+    int                    threads_finished; // threads done with the published phase (atomic)
+};
+
+/*
+ * A stop_ctl ends the measurement of all the threads together.  The threads
+ * poll it between chunks of their measurement loops, not only after every
+ * --lat-iterations or --bw-iterations, and the first thread to reach its
+ * hwcounter_stop raises it for all of them.  After a thread stops measuring,
+ * it drains: it keeps loading memory without measuring until every thread
+ * has stopped, so that the last samples of the other threads stay loaded.
+ */
+
+struct stop_ctl {
+    int           stop;             // 1 after any thread has reached its hwcounter_stop (atomic)
+    int           num_threads;      // threads that use this stop_ctl
+    int           threads_stopped __attribute__((aligned(64)));  // threads done measuring (atomic)
+};
+
+// called by a worker thread between chunks with the current hwcounter.
+// Returns 1 if the thread is to stop measuring.
+int stop_check(struct stop_ctl * ctl, unsigned long hwcounter, unsigned long hwcounter_stop);
+
+// called by a worker thread after it stops measuring, to start its drain
+void stop_arrive(struct stop_ctl * ctl);
+
+// called by a worker thread during its drain.  Returns 0 once every thread has stopped.
+int stop_draining(struct stop_ctl * ctl);
+
+// called by the main thread to rearm the stop between phases, after every thread has finished
+void stop_reset(struct stop_ctl * ctl);
+
+// called by a worker thread after it finishes phase *phase.  Returns 1 with
+// *phase advanced if there is another phase, or 0 if there are no more.
+int phase_wait_next(struct phase_ctl * ctl, int * phase);
+
+// called by the main thread to wait for num_threads to finish the current phase.
+// If poll is not NULL, it is called with poll_arg while waiting.
+void phase_wait_finished(struct phase_ctl * ctl, int num_threads, void (*poll)(void *), void * poll_arg);
+
+// called by the main thread to start the next phase
+void phase_publish(struct phase_ctl * ctl, unsigned long hwcounter_start, unsigned long hwcounter_stop);
+
+// called by the main thread to release the threads after the last phase
+void phase_end(struct phase_ctl * ctl);
+
+#endif
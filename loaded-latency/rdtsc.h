@@ -23,6 +23,33 @@ static inline unsigned long read_hwcounter(void) {
 }
 
 
+/* read_hwcounter_start() and read_hwcounter_stop() bracket a timed interval.
+   LFENCE before RDTSC waits for the instructions before it, and LFENCE after
+   it keeps the timed instructions from starting before it.  RDTSCP waits for
+   the timed instructions to execute, and the LFENCE after it keeps later
+   instructions from starting before it. */
+
+static inline unsigned long read_hwcounter_start(void) {
+    unsigned long tick;
+
+    _mm_lfence();
+    tick = __rdtsc();
+    _mm_lfence();
+
+    return tick;
+}
+
+static inline unsigned long read_hwcounter_stop(void) {
+    unsigned long tick;
+    unsigned int aux;
+
+    tick = __rdtscp(&aux);
+    _mm_lfence();
+
+    return tick;
+}
+
+
 static inline unsigned long read_cntfreq(void) {
     extern args_t args;
     return args.hwclock_freq;
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* xoshiro256** random number generator, seeded with splitmix64.  Each thread
+   keeps its own struct rng, so there is no shared state and a given seed and
+   stream always give the same sequence. */
+
+struct rng {
+    uint64_t s[4];
+};
+
+static inline uint64_t splitmix64(uint64_t * x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15UL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+    return z ^ (z >> 31);
+}
+
+// stream selects an independent sequence for the same seed, e.g. a thread number
+
+static inline void rng_seed(struct rng * rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed;
+    uint64_t y = splitmix64(&x) ^ stream;
+
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&y);
+    }
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(struct rng * rng) {
+    uint64_t * s = rng->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+
+    return result;
+}
+
+// random number in [0, n), by the high half of a 64 x 64-bit multiply
+
+static inline uint64_t rng_below(struct rng * rng, uint64_t n) {
+    return ((unsigned __int128) rng_next(rng) * n) >> 64;
+}
+
+#endif
@@ -52,12 +52,14 @@ if [ -n "$HWCLOCK_FREQ" ]; then
 	MORE_FLAGS+="--hwclock-freq $HWCLOCK_FREQ "
 fi
 
-# Delay time for all threads to finish setting up
+# Margin from the last thread being ready to the start of the measurement
 
-# XXX: Adjust DELAY_TIME_SECONDS so that the latency thread gets enough time
-# to set up its loop, or pass a new "--delay-seconds seconds" to this script
+# The run starts as soon as every thread has finished setting up, after a
+# margin that defaults to 0.01 seconds.  Uncomment the next line only if the
+# threads need a longer margin to all see the start time, e.g. on a heavily
+# loaded system, or pass a new "--delay-seconds seconds" to this script.
 
-DELAY_TIME_SECONDS=6
+#DELAY_TIME_SECONDS=0.1
 
 if [ -n "$DELAY_TIME_SECONDS" ]; then
 	MORE_FLAGS+="--delay-seconds $DELAY_TIME_SECONDS "
@@ -0,0 +1,223 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "stats.h"
+
+void sample_append(struct sample_buf * buf, const struct sample * sample) {
+
+    if (buf->count == buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 1024;
+        struct sample * samples = realloc(buf->samples, capacity * sizeof(struct sample));
+
+        if (samples == NULL) {
+            printf("realloc failed for %zu samples, exiting\n", capacity);
+            exit(-1);
+        }
+
+        buf->samples = samples;
+        buf->capacity = capacity;
+    }
+
+    buf->samples[buf->count] = *sample;
+    buf->count++;
+}
+
+void sample_reset(struct sample_buf * buf) {
+    buf->count = 0;
+}
+
+void sample_ring_init(struct sample_ring * ring) {
+    ring->samples = malloc(SAMPLE_RING_SIZE * sizeof(struct sample));
+
+    if (ring->samples == NULL) {
+        printf("malloc failed for a ring of %d samples, exiting\n", SAMPLE_RING_SIZE);
+        exit(-1);
+    }
+
+    ring->head = 0;
+    ring->dropped = 0;
+    ring->tail = 0;
+}
+
+void sample_ring_push(struct sample_ring * ring, unsigned long start_tick, unsigned long stop_tick, double value,
+        double core_mhz, const unsigned long * counts) {
+    unsigned long head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == SAMPLE_RING_SIZE) {
+        ring->dropped++;
+        return;
+    }
+
+    struct sample * sample = &ring->samples[head & (SAMPLE_RING_SIZE - 1)];
+
+    sample->start_tick = start_tick;
+    sample->stop_tick = stop_tick;
+    sample->value = value;
+    sample->core_mhz = core_mhz;
+
+    if (counts) {
+        memcpy(sample->counts, counts, sizeof(sample->counts));
+    } else {
+        memset(sample->counts, 0, sizeof(sample->counts));
+    }
+
+    // publish the sample after it is written
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+size_t sample_ring_drain(struct sample_ring * ring, struct sample_buf * buf) {
+    unsigned long tail = ring->tail;
+    unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    for (unsigned long i = tail; i < head; i++) {
+        const struct sample * sample = &ring->samples[i & (SAMPLE_RING_SIZE - 1)];
+        sample_append(buf, sample);
+    }
+
+    // release the slots after they are read
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+    return head - tail;
+}
+
+static int compare_doubles(const void * a, const void * b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+// percentile by linear interpolation between the closest ranks of sorted[]
+
+static double percentile(const double * sorted, size_t count, double pct) {
+    double rank = pct / 100. * (count - 1);
+    size_t lo = (size_t) rank;
+    size_t hi = lo + 1 < count ? lo + 1 : lo;
+
+    return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+// two-sided 97.5% quantile of Student's t distribution for 1 to 30 degrees of freedom
+
+static const double t_975[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+/* the standard table rows beyond 30 degrees of freedom, ending with the
+   normal quantile as df -> infinity.  Between rows, t is interpolated
+   linearly in 1/df, which is accurate to the third decimal. */
+
+static const struct {
+    double df;
+    double t;
+} t_975_tail[] = {
+    { 30, 2.042 }, { 40, 2.021 }, { 60, 2.000 }, { 120, 1.980 }, { INFINITY, 1.960 },
+};
+
+static double t_quantile_975(size_t df) {
+    size_t rows = sizeof(t_975_tail) / sizeof(t_975_tail[0]);
+
+    if (df <= sizeof(t_975) / sizeof(t_975[0])) {
+        return t_975[df - 1];
+    }
+
+    for (size_t i = 1; i < rows; i++) {
+        if (df <= t_975_tail[i].df) {
+            double x0 = 1 / t_975_tail[i - 1].df, x1 = 1 / t_975_tail[i].df;
+            double f = (1.0 / df - x0) / (x1 - x0);
+            return t_975_tail[i - 1].t + f * (t_975_tail[i].t - t_975_tail[i - 1].t);
+        }
+    }
+
+    return 1.960;
+}
+
+void compute_window_stats(const struct sample * samples, size_t count,
+        unsigned long window_start, unsigned long window_stop, struct window_stats * stats) {
+
+    double sum = 0.0;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i].start_tick >= window_start && samples[i].stop_tick <= window_stop) {
+            sum += samples[i].value;
+            stats->kept++;
+        } else {
+            stats->discarded_ticks += samples[i].stop_tick - samples[i].start_tick;
+            stats->discarded++;
+        }
+    }
+
+    stats->mean = stats->kept ? sum / stats->kept : NAN;
+}
+
+void compute_sample_stats(const struct sample * samples, size_t count, struct sample_stats * stats) {
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = count;
+
+    if (count == 0) {
+        stats->mean = stats->stddev = stats->ci95 = NAN;
+        stats->min = stats->p50 = stats->p90 = stats->p99 = stats->max = NAN;
+        return;
+    }
+
+    double * sorted = malloc(count * sizeof(double));
+    if (sorted == NULL) {
+        printf("malloc failed for %zu samples, exiting\n", count);
+        exit(-1);
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sorted[i] = samples[i].value;
+        sum += samples[i].value;
+    }
+
+    stats->mean = sum / count;
+
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double d = sorted[i] - stats->mean;
+        sum_sq += d * d;
+    }
+
+    if (count > 1) {
+        size_t df = count - 1;
+        double t = t_quantile_975(df);
+
+        stats->stddev = sqrt(sum_sq / df);
+        stats->ci95 = t * stats->stddev / sqrt(count);
+    } else {
+        stats->stddev = stats->ci95 = NAN;
+    }
+
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    stats->min = sorted[0];
+    stats->p50 = percentile(sorted, count, 50);
+    stats->p90 = percentile(sorted, count, 90);
+    stats->p99 = percentile(sorted, count, 99);
+    stats->max = sorted[count - 1];
+
+    free(sorted);
+}
+
+void print_sample_stats(const char * label, const struct sample_stats * stats, double scale, const char * unit) {
+    printf("%s: samples = %zu, mean = %f +/- %f (95%% CI), stddev = %f, "
+           "min = %f, p50 = %f, p90 = %f, p99 = %f, max = %f %s\n",
+           label, stats->count, stats->mean * scale, stats->ci95 * scale, stats->stddev * scale,
+           stats->min * scale, stats->p50 * scale, stats->p90 * scale, stats->p99 * scale,
+           stats->max * scale, unit);
+}
@@ -0,0 +1,82 @@
+
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#define SAMPLE_MAX_COUNTERS 8        // --perf events per sample, see perf.h
+
+struct sample {
+    unsigned long start_tick;       // HWCOUNTER at the start of the interval
+    unsigned long stop_tick;        // HWCOUNTER at the end of the interval
+    double        value;            // latency in ns or bandwidth in bytes/sec
+    double        core_mhz;         // --measure-cpu-freq core frequency of the interval, or 0
+    unsigned long counts[SAMPLE_MAX_COUNTERS];  // --perf event counts of the interval
+};
+
+// a growable array of the interim samples of one thread
+struct sample_buf {
+    struct sample * samples;
+    size_t          count;
+    size_t          capacity;
+};
+
+/* A sample_ring passes samples from the thread that measures them (the only
+   producer) to the main thread (the only consumer) without locks, so that
+   the measuring thread does not print or allocate memory.  If the ring is
+   full, the sample is dropped and counted. */
+
+#define SAMPLE_RING_SIZE 4096       // samples; must be a power of 2
+
+struct sample_ring {
+    struct sample * samples;        // SAMPLE_RING_SIZE entries
+    unsigned long   head;           // count of samples pushed; written by the producer only
+    unsigned long   dropped;        // count of samples dropped; written by the producer only
+    unsigned long   tail __attribute__((aligned(64)));  // count of samples drained; written by the consumer only
+};
+
+struct sample_stats {
+    size_t        count;
+    double        mean;
+    double        stddev;           // sample standard deviation
+    double        ci95;             // half-width of the 95% confidence interval of the mean
+    double        min;
+    double        p50;
+    double        p90;
+    double        p99;
+    double        max;
+};
+
+// the samples of one thread that lie entirely within a window of hwcounter ticks
+struct window_stats {
+    size_t        kept;             // samples that start and stop within the window
+    size_t        discarded;        // samples that start before or stop after the window
+    unsigned long discarded_ticks;  // measurement time of the discarded samples
+    double        mean;             // mean of the kept samples
+};
+
+void sample_append(struct sample_buf * buf, const struct sample * sample);
+
+void sample_reset(struct sample_buf * buf);
+
+void sample_ring_init(struct sample_ring * ring);
+
+// counts may be NULL if --perf is not used, and core_mhz is 0 if it is not measured
+void sample_ring_push(struct sample_ring * ring, unsigned long start_tick, unsigned long stop_tick, double value,
+        double core_mhz, const unsigned long * counts);
+
+// moves the samples in the ring to the end of buf and returns how many were moved
+size_t sample_ring_drain(struct sample_ring * ring, struct sample_buf * buf);
+
+void compute_sample_stats(const struct sample * samples, size_t count, struct sample_stats * stats);
+
+void compute_window_stats(const struct sample * samples, size_t count,
+        unsigned long window_start, unsigned long window_stop, struct window_stats * stats);
+
+// prints the stats with every value multiplied by scale, e.g. 1e-6 for bytes/sec to MB/sec
+void print_sample_stats(const char * label, const struct sample_stats * stats, double scale, const char * unit);
+
+#endif
@@ -20,6 +20,11 @@
 #
 #   ./sweep.finedelay.sh -B2 -B5 -B8
 #
+# loaded-latency can also sweep the fine delays in a single process, which
+# avoids re-initializing the buffers for every value:
+#
+#   ./run-200mb.bandwidth-latency.sh --sweep-fine-delay 100,50,30,20,15,10,5,0
+#
 
 MYSCRIPT="./run-200mb.bandwidth-latency.sh"
 
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topology.h"
+
+// read a sysfs CPU list such as "0-3,8-11".  Returns 0 if the file cannot be read.
+
+static int read_cpulist(const char * path, cpu_set_t * cpus) {
+    char buf[4096];
+    FILE * f = fopen(path, "r");
+
+    CPU_ZERO(cpus);
+
+    if (f == NULL) {
+        return 0;
+    }
+
+    if (fgets(buf, sizeof(buf), f) == NULL) {
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+
+    char * s = buf;
+
+    while (*s && *s != '\n') {
+        char * endptr;
+        long first = strtol(s, &endptr, 10);
+        long last = first;
+
+        if (endptr == s) {
+            break;
+        }
+        if (*endptr == '-') {
+            s = endptr + 1;
+            last = strtol(s, &endptr, 10);
+        }
+
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, cpus);
+        }
+
+        s = (*endptr == ',') ? endptr + 1 : endptr;
+    }
+
+    return 1;
+}
+
+void topology_allowed_cpus(cpu_set_t * cpus) {
+    if (sched_getaffinity(0, sizeof(cpu_set_t), cpus)) {
+        perror("sched_getaffinity");
+        exit(-1);
+    }
+}
+
+int topology_node_cpus(int node, cpu_set_t * cpus) {
+    char path[128];
+    cpu_set_t allowed;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+    if (node < 0 || ! read_cpulist(path, cpus)) {
+        return 0;
+    }
+
+    topology_allowed_cpus(&allowed);
+    CPU_AND(cpus, cpus, &allowed);
+
+    return 1;
+}
+
+void topology_core_cpus(cpu_set_t * cpus) {
+    char path[128];
+    cpu_set_t allowed, siblings;
+
+    topology_allowed_cpus(&allowed);
+    CPU_ZERO(cpus);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (! CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+
+        // without the topology, a CPU is taken to be a core of its own
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (! read_cpulist(path, &siblings)) {
+            CPU_SET(cpu, cpus);
+            continue;
+        }
+
+        // keep the CPU if no lower-numbered allowed CPU is a thread of the same core
+
+        int lowest = cpu;
+        for (int other = 0; other < cpu; other++) {
+            if (CPU_ISSET(other, &siblings) && CPU_ISSET(other, &allowed)) {
+                lowest = other;
+                break;
+            }
+        }
+
+        if (lowest == cpu) {
+            CPU_SET(cpu, cpus);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2019-2023 Arm Limited and/or its affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/*
+ * The CPU topology, read from sysfs, for the selectors of the CPU lists of
+ * --lat-cpus and --bw-cpus.  Every set is limited to the CPUs that this
+ * process is allowed to run on, which a cpuset or taskset may restrict.
+ */
+
+// the CPUs that this process is allowed to run on
+void topology_allowed_cpus(cpu_set_t * cpus);
+
+// the allowed CPUs of NUMA node node.  Returns 0 if there is no such node.
+int topology_node_cpus(int node, cpu_set_t * cpus);
+
+// the lowest-numbered allowed CPU of each physical core, i.e. one thread per core
+void topology_core_cpus(cpu_set_t * cpus);
+
+#endif